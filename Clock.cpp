@@ -37,6 +37,13 @@ Clock::~Clock()
 }
 
 
+std::uint64_t
+Clock::getNanoseconds()
+{
+   return( (std::uint64_t) ( getTime() * 1.0e9 ) );
+}
+
+
 sclock_t
 Clock::getResolution()
 {
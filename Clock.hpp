@@ -19,6 +19,7 @@
  */
 #ifndef _CLOCK_HPP_
 #define _CLOCK_HPP_  1
+#include <cstdint>
 
 typedef double sclock_t;
 
@@ -30,6 +31,14 @@ public:
 
    virtual sclock_t getTime() = 0;
 
+   /**
+    * getNanoseconds - integer time since the clock started, the
+    * default just converts getTime(), clocks with an integer
+    * source override it to skip the round trip through double.
+    * @return std::uint64_t
+    */
+   virtual std::uint64_t getNanoseconds();
+
    sclock_t getResolution();
 
 private:
@@ -27,7 +27,15 @@
 #include <cstring>
 #include <unistd.h>
 #include <pthread.h>
+#include <atomic>
+#include <string>
+#include <thread>
 #include "Clock.hpp"
+#include "seqlock.tcc"
+#include "affinity.hpp"
+#include "x86cpuid.h"
+#include "region.tcc"
+#include "ringbuffertypes.hpp"
 
 #ifdef __APPLE__
 #include <mach/mach.h>
@@ -45,14 +53,13 @@
 
 /**
  * TODO:
- * 1) Add new constructor for allocating in SHM
- * 2) Add accessor for getting SHM Key to open
- * 3) Add accessor to open SHM for new processes 
- *    to use the counter.
- * 4) Fix the latency issue (time for system calls and assembly code 
+ * 1) Fix the latency issue (time for system calls and assembly code 
+ *
+ * For a clock shared between processes see the SHM constructor
+ * of SystemClock< TSC > below.
  */
 
-enum ClockType  { Dummy, Cycle, System };
+enum ClockType  { Dummy, Cycle, System, TSC };
 
 template < ClockType T > class SystemClock : public Clock {
 public:
@@ -97,32 +104,25 @@ private:
 
    class Clock {
    public:
-      Clock() : a( (sclock_t) 0 ),
-                b( (sclock_t) 0 )
+      Clock() : current( (sclock_t) 0 )
       {}
       
+      /** only ever called by the updater thread **/
       inline void increment( const sclock_t inc = (sclock_t) 1 )
       {
-         a += inc;
-         b += inc;
+         current += inc;
+         value.write( current );
       }
 
       inline sclock_t read()
       {
-         struct{
-            sclock_t a;
-            sclock_t b;
-         } copy;
-         do{
-            copy.a = a;
-            copy.b = b;
-         }while( copy.a != copy.b );
-         return( copy.b );
+         return( value.read() );
       }
 
    private:
-      volatile sclock_t a;
-      volatile sclock_t b;
+      SeqLock< sclock_t > value;
+      /** updater local copy so writes don't have to read back **/
+      sclock_t            current;
    };
 
    struct ThreadData{
@@ -200,33 +200,12 @@ private:
             /**
              * pin the current thread 
              */
-            cpu_set_t   *cpuset( nullptr );
-            size_t cpu_allocate_size( -1 );
-#if   (__GLIBC_MINOR__ > 9 ) && (__GLIBC__ == 2 )
-            const int8_t   processors_to_allocate( 1 );
-            cpuset = CPU_ALLOC( processors_to_allocate );
-            assert( cpuset != nullptr );
-            cpu_allocate_size = CPU_ALLOC_SIZE( processors_to_allocate );
-            CPU_ZERO_S( cpu_allocate_size, cpuset );
-#else
-            cpu_allocate_size = sizeof( cpu_set_t );
-            cpuset = (cpu_set_t*) malloc( cpu_allocate_size );
-            assert( cpuset != nullptr );
-            CPU_ZERO( cpuset );
-#endif
             /** TODO, make configurable **/
-            CPU_SET( d->core,
-                     cpuset );
-            errno = 0;
-            if( sched_setaffinity( 0 /* calling thread */,
-                                  cpu_allocate_size,
-                                  cpuset ) != 0 )
+            if( ! Affinity::pin( d->core ) )
             {
-               perror( "Failed to set affinity for cycle counter!!" );
+               /** pin() already said why **/
                exit( EXIT_FAILURE );
             }
-            /** wait till we know we're on the right processor **/
-            pthread_yield();
             /** get to the timing, previous is captured by the lambda function **/
             uint64_t previous( 0 );
             /** begin assembly section to init previous **/
@@ -430,4 +409,306 @@ private:
 
    pthread_t         updater;
 };
+
+
+/**
+ * SystemClock< TSC > - reads an invariant time stamp counter in
+ * the calling thread, no updater thread.  The counter is checked
+ * for invariance with cpuid and calibrated once against
+ * CLOCK_MONOTONIC at construction.  If there is no invariant TSC
+ * (or this isn't x86) it falls back to SystemClock< System >,
+ * which does need the updater thread, pinned to core.
+ *
+ * The SHM constructor shares one timebase between processes: the
+ * Producer calibrates and publishes its base and scale in a small
+ * segment, every Consumer that opens the key reads the counter
+ * itself with the published values so they all agree.  Without an
+ * invariant TSC the shared clock publishes a CLOCK_MONOTONIC base
+ * instead, which is just as common to every process, so nothing
+ * has to keep a thread running for the readers.
+ */
+template <> class SystemClock< TSC > : public Clock {
+public:
+   SystemClock( int core = 0 ) : fallback( nullptr ),
+                                 region( nullptr ),
+                                 monotonic( false ),
+                                 base( 0 ),
+                                 mult( 0 ),
+                                 frequency( 0 )
+   {
+      if( ! calibrate() )
+      {
+         fallback = new SystemClock< System >( core );
+      }
+   }
+
+   /**
+    * SystemClock - shared clock, the Producer publishes it under
+    * key and keeps the segment alive till it is destroyed, any
+    * Consumer opens it and waits for the Producer to publish.
+    * @param key - const std::string, SHM key
+    * @param dir - Direction, Producer publishes, Consumer opens
+    */
+   SystemClock( const std::string key,
+                Direction dir ) : fallback( nullptr ),
+                                  region( nullptr ),
+                                  monotonic( false ),
+                                  base( 0 ),
+                                  mult( 0 ),
+                                  frequency( 0 )
+   {
+      region = new Buffer::Region< RingBufferType::SharedMemory >(
+         sizeof( Published ), key, dir );
+      share( dir );
+   }
+
+   /**
+    * SystemClock - shared clock on an anonymous (memfd) segment,
+    * the Producer creates it and hands getFd() to the Consumers,
+    * e.g. by forking or SHM::SendFd.
+    * @param fd  - const int, ignored by the Producer
+    * @param dir - Direction, Producer publishes, Consumer maps fd
+    */
+   SystemClock( const int fd,
+                Direction dir ) : fallback( nullptr ),
+                                  region( nullptr ),
+                                  monotonic( false ),
+                                  base( 0 ),
+                                  mult( 0 ),
+                                  frequency( 0 )
+   {
+      region = new Buffer::Region< RingBufferType::SharedMemory >(
+         sizeof( Published ), ( dir == Direction::Producer ? -1 : fd ) );
+      share( dir );
+   }
+
+   virtual ~SystemClock()
+   {
+      delete( fallback );
+      fallback = nullptr;
+      delete( region );
+      region = nullptr;
+   }
+
+   virtual sclock_t getTime()
+   {
+      return( (sclock_t) getNanoseconds() * 1.0e-9 );
+   }
+
+   virtual std::uint64_t getNanoseconds()
+   {
+      if( monotonic )
+      {
+         return( monotonicNanoseconds() - base );
+      }
+      if( fallback != nullptr )
+      {
+         return( fallback->getNanoseconds() );
+      }
+      return( ticksToNanoseconds( readTSC() - base ) );
+   }
+
+   /**
+    * getTicks - raw counter, only meaningful relative to another
+    * getTicks() from this clock.  Nanoseconds when not on the TSC.
+    * @return std::uint64_t
+    */
+   std::uint64_t getTicks()
+   {
+      if( ! isTSC() )
+      {
+         return( getNanoseconds() );
+      }
+      return( readTSC() );
+   }
+
+   /**
+    * ticksToNanoseconds - convert a difference of getTicks().
+    * @param ticks - const std::uint64_t
+    * @return std::uint64_t
+    */
+   std::uint64_t ticksToNanoseconds( const std::uint64_t ticks ) const
+   {
+      if( ! isTSC() )
+      {
+         return( ticks );
+      }
+      /** 32.32 fixed point ns per tick **/
+      return( (std::uint64_t) ( ( (unsigned __int128) ticks * mult ) >> 32 ) );
+   }
+
+   /**
+    * getFrequency - calibrated ticks per second, zero when not
+    * on the TSC.
+    * @return std::uint64_t
+    */
+   std::uint64_t getFrequency() const
+   {
+      return( frequency );
+   }
+
+   /**
+    * isTSC - false if we're running on a fallback clock.
+    * @return bool
+    */
+   bool isTSC() const
+   {
+      return( fallback == nullptr && ! monotonic );
+   }
+
+   /**
+    * getKey - SHM key other processes pass to the Consumer side
+    * constructor, empty if this clock isn't shared.
+    * @return std::string
+    */
+   std::string getKey() const
+   {
+      return( region != nullptr ? region->key : std::string() );
+   }
+
+   /**
+    * getFd - memfd other processes pass to the Consumer side fd
+    * constructor, -1 unless this is an anonymous Producer clock.
+    * @return int
+    */
+   int getFd() const
+   {
+      return( region != nullptr ? region->fd : -1 );
+   }
+
+private:
+   /** Producer calibrates and publishes, Consumer waits and reads **/
+   void share( Direction dir )
+   {
+      Published *published( reinterpret_cast< Published* >( region->ptr ) );
+      if( dir == Direction::Producer )
+      {
+         if( ! calibrate() )
+         {
+            monotonic = true;
+            base      = monotonicNanoseconds();
+         }
+         published->monotonic = ( monotonic ? 1 : 0 );
+         published->base      = base;
+         published->mult      = mult;
+         published->frequency = frequency;
+         published->ready.store( Published::magic, std::memory_order_release );
+      }
+      else
+      {
+         while( published->ready.load( std::memory_order_acquire ) != 
+                   Published::magic )
+         {
+            std::this_thread::yield();
+         }
+         monotonic = ( published->monotonic != 0 );
+         base      = published->base;
+         mult      = published->mult;
+         frequency = published->frequency;
+      }
+   }
+
+   /** what the Producer writes into the shared segment **/
+   struct Published
+   {
+      static const std::uint32_t   magic = 0x1337;
+      std::atomic< std::uint32_t > ready;
+      std::uint32_t                monotonic;
+      std::uint64_t                base;
+      std::uint64_t                mult;
+      std::uint64_t                frequency;
+   };
+
+   static inline std::uint64_t readTSC()
+   {
+#ifdef   __x86_64
+      std::uint32_t lo( 0 ), hi( 0 );
+      __asm__ volatile(
+#if RDTSCP
+         "rdtscp"
+         : "=a" (lo), "=d" (hi)
+         :
+         : "rcx"
+#else
+         "\
+         lfence                           \n\
+         rdtsc"
+         : "=a" (lo), "=d" (hi)
+         :
+         :
+#endif
+      );
+      return( ( (std::uint64_t) hi << 32 ) | lo );
+#else
+      return( 0 );
+#endif
+   }
+
+   static inline std::uint64_t monotonicNanoseconds()
+   {
+      struct timespec now;
+      clock_gettime( CLOCK_MONOTONIC, &now );
+      return( ( (std::uint64_t) now.tv_sec * 1000000000ULL ) +
+                 (std::uint64_t) now.tv_nsec );
+   }
+
+   /**
+    * calibrate - measure ticks per ns over a short sleep, each
+    * end is a CLOCK_MONOTONIC read bracketed by two counter reads,
+    * keeping the tightest of a few tries so a preemption in the
+    * middle doesn't skew the result.
+    * @return bool - false if the TSC can't be used
+    */
+   bool calibrate()
+   {
+#if defined __x86_64 && defined __linux
+      if( ! get_invariant_tsc() )
+      {
+         return( false );
+      }
+      auto sample = []( std::uint64_t &ns, std::uint64_t &tsc )
+      {
+         std::uint64_t best( UINT64_MAX );
+         for( int i( 0 ); i < 8; i++ )
+         {
+            const std::uint64_t before( readTSC() );
+            const std::uint64_t now( monotonicNanoseconds() );
+            const std::uint64_t after( readTSC() );
+            if( after - before < best )
+            {
+               best = after - before;
+               ns   = now;
+               tsc  = before + ( ( after - before ) / 2 );
+            }
+         }
+      };
+      std::uint64_t ns_start( 0 ), tsc_start( 0 );
+      std::uint64_t ns_end( 0 ),   tsc_end( 0 );
+      sample( ns_start, tsc_start );
+      const struct timespec interval( { .tv_sec = 0, .tv_nsec = 20000000 } );
+      nanosleep( &interval, nullptr );
+      sample( ns_end, tsc_end );
+      const std::uint64_t ns( ns_end - ns_start );
+      const std::uint64_t ticks( tsc_end - tsc_start );
+      if( ns == 0 || ticks == 0 )
+      {
+         return( false );
+      }
+      mult      = ( ns << 32 ) / ticks;
+      frequency = (std::uint64_t) ( ( (unsigned __int128) ticks * 1000000000ULL ) / ns );
+      base      = readTSC();
+      return( true );
+#else
+      return( false );
+#endif
+   }
+
+   SystemClock< System >                             *fallback;
+   /** only set for the shared clock **/
+   Buffer::Region< RingBufferType::SharedMemory >    *region;
+   bool                                               monotonic;
+   std::uint64_t                                      base;
+   std::uint64_t                                      mult;
+   std::uint64_t                                      frequency;
+};
 #endif /* END _SYSTEMCLOCK_HPP_ */
@@ -0,0 +1,268 @@
+/**
+ * affinity.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 15:10:09 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <mutex>
+#include <unistd.h>
+#if __linux
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE 1
+#endif
+#include <sched.h>
+#include <sys/syscall.h>
+#endif
+#include "affinity.hpp"
+#include "systeminfo.hpp"
+
+#if __linux
+/** from numaif.h, here so we don't need libnuma installed **/
+#ifndef MPOL_BIND
+#define MPOL_BIND    2
+#endif
+#ifndef MPOL_MF_MOVE
+#define MPOL_MF_MOVE ( 1 << 1 )
+#endif
+#endif
+
+Placement::Placement() : producer_cpu( -1 ),
+                         consumer_cpu( -1 ),
+                         node( -1 ),
+                         pin( false )
+{
+}
+
+Placement
+Placement::Auto( const bool pin )
+{
+   /** cpus handed out by earlier calls **/
+   static std::mutex          lock;
+   static std::vector< int >  taken;
+   std::lock_guard< std::mutex > guard( lock );
+   auto pair( Affinity::closestPair( -1, false, taken ) );
+   if( pair.first < 0 && taken.size() > 0 )
+   {
+      /** every pair is in use, start over **/
+      taken.clear();
+      pair = Affinity::closestPair( -1, false, taken );
+   }
+   if( pair.first < 0 )
+   {
+      return( Placement() );
+   }
+   taken.push_back( pair.first );
+   taken.push_back( pair.second );
+   return( Placement::Cores( pair.first, pair.second, pin ) );
+}
+
+Placement
+Placement::Cores( const int producer,
+                  const int consumer,
+                  const bool pin )
+{
+   Placement placement;
+   placement.producer_cpu = producer;
+   placement.consumer_cpu = consumer;
+   placement.node         = SystemInfo::getTopology().getNode( consumer );
+   placement.pin          = pin;
+   return( placement );
+}
+
+Placement
+Placement::Node( const int node )
+{
+   Placement placement;
+   placement.node = node;
+   return( placement );
+}
+
+
+bool
+Affinity::pin( const int cpu )
+{
+   return( Affinity::pin( std::vector< int >( 1, cpu ) ) );
+}
+
+bool
+Affinity::pin( const std::vector< int > &cpus )
+{
+#if __linux
+   cpu_set_t   *cpuset( nullptr );
+   int max_cpu( 0 );
+   for( const int cpu : cpus )
+   {
+      if( cpu > max_cpu )
+      {
+         max_cpu = cpu;
+      }
+   }
+   const size_t cpu_allocate_size( CPU_ALLOC_SIZE( max_cpu + 1 ) );
+   cpuset = CPU_ALLOC( max_cpu + 1 );
+   if( cpuset == nullptr )
+   {
+      perror( "Failed to allocate cpu set" );
+      return( false );
+   }
+   CPU_ZERO_S( cpu_allocate_size, cpuset );
+   for( const int cpu : cpus )
+   {
+      CPU_SET_S( cpu, cpu_allocate_size, cpuset );
+   }
+   errno = 0;
+   const bool success( sched_setaffinity( 0 /* calling thread */,
+                                          cpu_allocate_size,
+                                          cpuset ) == 0 );
+   if( ! success )
+   {
+      perror( "Failed to set affinity" );
+   }
+   CPU_FREE( cpuset );
+   if( success )
+   {
+      /** wait till we know we're on the right processor **/
+      sched_yield();
+   }
+   return( success );
+#else
+   (void) cpus;
+   return( false );
+#endif
+}
+
+int
+Affinity::currentCPU()
+{
+#if __linux
+   return( sched_getcpu() );
+#else
+   return( -1 );
+#endif
+}
+
+bool
+Affinity::bindMemory( void *ptr, const size_t length, const int node )
+{
+#if __linux
+   if( ptr == nullptr || length == 0 || node < 0 )
+   {
+      return( false );
+   }
+   const std::uintptr_t page( Affinity::pageSize() );
+   const std::uintptr_t begin( reinterpret_cast< std::uintptr_t >( ptr ) &
+                                  ~( page - 1 ) );
+   const std::uintptr_t end(
+      ( reinterpret_cast< std::uintptr_t >( ptr ) + length + page - 1 ) &
+         ~( page - 1 ) );
+   const size_t bits_per_word( sizeof( unsigned long ) * 8 );
+   const size_t words( 1024 / bits_per_word );
+   unsigned long mask[ 1024 / ( sizeof( unsigned long ) * 8 ) ];
+   std::memset( mask, 0, sizeof( mask ) );
+   if( (size_t) node >= words * bits_per_word )
+   {
+      return( false );
+   }
+   mask[ node / bits_per_word ] |= ( 1UL << ( node % bits_per_word ) );
+   errno = 0;
+   /** the kernel counts maxnode one past the last bit **/
+   if( syscall( SYS_mbind,
+                reinterpret_cast< void* >( begin ),
+                end - begin,
+                MPOL_BIND,
+                mask,
+                ( words * bits_per_word ) + 1,
+                MPOL_MF_MOVE ) != 0 )
+   {
+      perror( "Failed to bind memory to NUMA node" );
+      return( false );
+   }
+   return( true );
+#else
+   (void) ptr;
+   (void) length;
+   (void) node;
+   return( false );
+#endif
+}
+
+std::pair< int, int >
+Affinity::closestPair( const int near,
+                       const bool allow_smt,
+                       const std::vector< int > &exclude )
+{
+   auto excluded( [&]( const int cpu )
+   {
+      return( std::find( exclude.begin(), exclude.end(), cpu ) != exclude.end() );
+   } );
+   const Topology &topology( SystemInfo::getTopology() );
+   const std::vector< int > cpus( topology.getCPUs() );
+   std::pair< int, int > best( -1, -1 );
+   int best_score( INT32_MAX );
+   for( const int a : cpus )
+   {
+      if( ( near >= 0 && a != near ) || excluded( a ) )
+      {
+         continue;
+      }
+      for( const int b : cpus )
+      {
+         if( a == b || excluded( b ) )
+         {
+            continue;
+         }
+         /** lower is better **/
+         int score( 0 );
+         if( topology.areSMTSiblings( a, b ) )
+         {
+            score = ( allow_smt ? 1 : 100 );
+         }
+         else
+         {
+            const int level( topology.sharedCacheLevel( a, b ) );
+            if( level > 0 )
+            {
+               score = 1 + level;
+            }
+            else if( topology.samePackage( a, b ) )
+            {
+               score = 10;
+            }
+            else
+            {
+               score = 20;
+            }
+         }
+         if( score < best_score )
+         {
+            best_score = score;
+            best       = std::make_pair( a, b );
+         }
+      }
+   }
+   return( best );
+}
+
+size_t
+Affinity::pageSize()
+{
+   static const size_t page( (size_t) sysconf( _SC_PAGESIZE ) );
+   return( page );
+}
@@ -0,0 +1,134 @@
+/**
+ * affinity.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 15:10:09 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _AFFINITY_HPP_
+#define _AFFINITY_HPP_  1
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+/**
+ * Placement - where the two ends of a queue should run and which
+ * NUMA node its memory should live on.  -1 means don't care, the
+ * default constructed Placement leaves everything to the OS.
+ */
+struct Placement
+{
+   Placement();
+
+   /**
+    * Auto - closest pair of distinct physical cores (sharing the
+    * lowest cache level available), memory on the consumer's node.
+    * Each call hands out a pair none of the earlier calls did, so
+    * queues placed one after another don't pile onto the same two
+    * cores, until the cpus run out and it starts over.
+    * @param pin - const bool, pin endpoints when they call pin()
+    * @return Placement
+    */
+   static Placement Auto( const bool pin = true );
+
+   /**
+    * Cores - explicit cores, memory on the consumer's node.
+    * @param producer - const int, cpu for the producer end
+    * @param consumer - const int, cpu for the consumer end
+    * @param pin      - const bool, pin endpoints on pin()
+    * @return Placement
+    */
+   static Placement Cores( const int producer,
+                           const int consumer,
+                           const bool pin = true );
+
+   /**
+    * Node - only place the memory, don't move any threads.
+    * @param node - const int, NUMA node
+    * @return Placement
+    */
+   static Placement Node( const int node );
+
+   int  producer_cpu;
+   int  consumer_cpu;
+   int  node;
+   bool pin;
+};
+
+/**
+ * Affinity - thread pinning and NUMA memory binding without
+ * pulling in libnuma.  Failures are reported to stderr and
+ * returned as false, placement is an optimization so callers
+ * are expected to carry on.
+ */
+class Affinity
+{
+public:
+   Affinity()           = delete;
+   virtual ~Affinity()  = delete;
+
+   /**
+    * pin - pin the calling thread to a single cpu.
+    * @param cpu - const int
+    * @return bool - true if successful
+    */
+   static bool pin( const int cpu );
+
+   /**
+    * pin - pin the calling thread to a set of cpus.
+    * @param cpus - const std::vector< int >&
+    * @return bool - true if successful
+    */
+   static bool pin( const std::vector< int > &cpus );
+
+   /**
+    * currentCPU - cpu the calling thread is running on now.
+    * @return int, -1 if unknown
+    */
+   static int  currentCPU();
+
+   /**
+    * bindMemory - bind (and migrate if already touched) the pages
+    * covering [ ptr, ptr + length ) to node.  Pages are the unit
+    * so anything sharing the first or last page moves as well.
+    * @param ptr    - void*
+    * @param length - const size_t
+    * @param node   - const int
+    * @return bool - true if successful
+    */
+   static bool bindMemory( void *ptr, const size_t length, const int node );
+
+   /**
+    * closestPair - pick two cpus for a producer/consumer pair,
+    * preferring distinct cores sharing an L2, then an L3, then
+    * the same package.  SMT siblings are only chosen if allowed
+    * or there is nothing else.
+    * @param near      - const int, if >= 0 the first cpu is fixed
+    * @param allow_smt - const bool, default false
+    * @param exclude   - const std::vector< int >&, cpus not to pick
+    * @return std::pair< int, int >, ( -1, -1 ) if < 2 cpus are left
+    */
+   static std::pair< int, int > closestPair( const int near = -1,
+                                             const bool allow_smt = false,
+                                             const std::vector< int > &exclude =
+                                                std::vector< int >() );
+
+   /**
+    * pageSize - system page size in bytes.
+    * @return size_t
+    */
+   static size_t pageSize();
+};
+#endif /* END _AFFINITY_HPP_ */
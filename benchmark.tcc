@@ -0,0 +1,1047 @@
+/**
+ * benchmark.tcc - shared pieces of the queue benchmarks, the
+ * throughput and ping-pong runs, the wait strategies and a loopback
+ * TCP bridge standing in for the (not yet written) TCP RingBuffer.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 16:58:12 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _BENCHMARK_TCC_
+#define _BENCHMARK_TCC_  1
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include "ringbuffer.tcc"
+#include "slabchannel.tcc"
+#include "queueset.hpp"
+#include "queueregistry.hpp"
+#include "affinity.hpp"
+#include "shm.hpp"
+#include "procwait.hpp"
+#include "histogram.hpp"
+#include "systeminfo.hpp"
+#include "perfcounters.hpp"
+#include "spinwait.hpp"
+
+namespace Bench
+{
+
+enum WaitStrategy { Spin, Yield, Block };
+
+/**
+ * queue_name - registry name for one of a run's SHM queues,
+ * unique within this process and, through the pid, the machine.
+ * @param role - const char*, e.g. "data"
+ * @return std::string
+ */
+static inline std::string queue_name( const char *role )
+{
+   static std::atomic< size_t > runs( 0 );
+   return( "rbbench." + std::to_string( getpid() ) + "." +
+           std::to_string( runs.fetch_add( 1 ) ) + "." + role );
+}
+
+/**
+ * Payload - an element of exactly N bytes, the first word
+ * carries a sequence number so the consumer can check order.
+ */
+template < size_t N > struct Payload
+{
+   static_assert( N >= sizeof( std::uint64_t ),
+                  "Payload needs room for a sequence number" );
+   char bytes[ N ];
+};
+
+/** one point of a sweep **/
+struct Config
+{
+   Config() : backing( RingBufferType::Heap ),
+              element_size( 8 ),
+              capacity( 1024 ),
+              wait( WaitStrategy::Spin ),
+              batch( 1 ),
+              producer_cpu( -1 ),
+              consumer_cpu( -1 ),
+              items( 10000000 ),
+              counters( false ),
+              defer( 1 ),
+              zero_copy( false )
+   {}
+
+   RingBufferType backing;
+   size_t         element_size;
+   size_t         capacity;
+   WaitStrategy   wait;
+   size_t         batch;
+   int            producer_cpu;
+   int            consumer_cpu;
+   size_t         items;
+   /** capture PerfCounters around each endpoint's loop **/
+   bool           counters;
+   /** defer_publication() batch for every queue, 1 publishes each op **/
+   size_t         defer;
+   /** payloads in SlabChannel blocks, only handles are queued **/
+   bool           zero_copy;
+};
+
+struct Result
+{
+   Result() : seconds( 0.0 ),
+              items( 0 ),
+              in_order( true )
+   {}
+
+   double         seconds;
+   std::uint64_t  items;
+   /** false if the consumer saw a sequence number out of place **/
+   bool           in_order;
+   /** only filled in when Config::counters is set **/
+   CounterSample  producer_counters;
+   CounterSample  consumer_counters;
+};
+
+/**
+ * Waiter - one endpoint's wait strategy.  Callers loop on their
+ * own readiness test and call wait() each time it fails, Spin
+ * and Yield just back off, Block sleeps on the queue's control
+ * words through a QueueSet.
+ */
+class Waiter
+{
+public:
+   template < class T, RingBufferType type >
+   Waiter( RingBufferBase< T, type > &queue,
+           const Interest interest,
+           const WaitStrategy strategy ) : strategy( strategy )
+   {
+      /** only Block sleeps, don't make the others pay for wakeups **/
+      if( strategy == WaitStrategy::Block )
+      {
+         set.add( queue, interest );
+      }
+   }
+
+   inline void wait()
+   {
+      switch( strategy )
+      {
+         case( WaitStrategy::Spin ):
+         {
+            spin_pause();
+         }
+         break;
+         case( WaitStrategy::Yield ):
+         {
+            std::this_thread::yield();
+         }
+         break;
+         case( WaitStrategy::Block ):
+         {
+            set.wait( ready );
+         }
+         break;
+      }
+   }
+
+private:
+   const WaitStrategy      strategy;
+   QueueSet                set;
+   std::vector< size_t >   ready;
+};
+
+/**
+ * StartLine - both endpoints check in, the clock starts once the
+ * last one arrives so queue construction and SHM handshakes are
+ * not part of the measurement.
+ */
+class StartLine
+{
+public:
+   StartLine( const size_t parties ) : parties( parties ),
+                                       arrived( 0 ),
+                                       start( 0 )
+   {}
+
+   void arrive()
+   {
+      if( arrived.fetch_add( 1, std::memory_order_acq_rel ) + 1 == parties )
+      {
+         start.store( system_clock->getNanoseconds(), std::memory_order_release );
+      }
+      while( start.load( std::memory_order_acquire ) == 0 )
+      {
+         std::this_thread::yield();
+      }
+   }
+
+   std::uint64_t started() const
+   {
+      return( start.load( std::memory_order_acquire ) );
+   }
+
+private:
+   const size_t                   parties;
+   std::atomic< size_t >          arrived;
+   std::atomic< std::uint64_t >   start;
+};
+
+/**
+ * produce - push config.items items, up to config.batch at a time,
+ * waiting with the configured strategy whenever the queue is full.
+ * The last item carries RBEOF.
+ */
+template < class T, RingBufferType type >
+static void produce( RingBufferBase< T, type > &queue,
+                     const Config &config )
+{
+   Waiter waiter( queue, Interest::Writable, config.wait );
+   std::vector< T > batch( config.batch );
+   std::uint64_t sequence( 0 );
+   while( sequence < config.items )
+   {
+      size_t avail( 0 );
+      while( ( avail = queue.space_avail() ) == 0 )
+      {
+         waiter.wait();
+      }
+      const size_t remaining( config.items - sequence );
+      const size_t n( std::min( std::min( avail, config.batch ), remaining ) );
+      for( size_t i( 0 ); i < n; i++ )
+      {
+         std::memcpy( batch[ i ].bytes, &sequence, sizeof( sequence ) );
+         sequence++;
+      }
+      queue.insert( batch.begin(),
+                    batch.begin() + n,
+                    ( sequence == config.items ? RBSignal::RBEOF :
+                                                 RBSignal::NONE ) );
+   }
+}
+
+/**
+ * consume - pop config.items items, up to config.batch per wake,
+ * checking that sequence numbers arrive in order.
+ * @return bool - true if everything arrived in order
+ */
+template < class T, RingBufferType type >
+static bool consume( RingBufferBase< T, type > &queue,
+                     const Config &config )
+{
+   Waiter waiter( queue, Interest::Readable, config.wait );
+   bool in_order( true );
+   std::uint64_t expected( 0 );
+   T item;
+   while( expected < config.items )
+   {
+      size_t avail( 0 );
+      while( ( avail = queue.size() ) == 0 )
+      {
+         waiter.wait();
+      }
+      const size_t n( std::min( avail, config.batch ) );
+      for( size_t i( 0 ); i < n; i++ )
+      {
+         queue.pop( item );
+         std::uint64_t sequence( 0 );
+         std::memcpy( &sequence, item.bytes, sizeof( sequence ) );
+         in_order = in_order && ( sequence == expected );
+         expected++;
+      }
+   }
+   return( in_order );
+}
+
+/**
+ * TcpBridge - moves items from one heap queue to another over a
+ * loopback TCP connection, one thread each way, so the producer
+ * and consumer only ever see RingBuffers.  Stands in for the TCP
+ * RingBuffer specialization until that exists.
+ */
+template < class T > class TcpBridge
+{
+public:
+   TcpBridge( RingBuffer< T > &in,
+              RingBuffer< T > &out,
+              const size_t items ) : in( in ),
+                                     out( out ),
+                                     items( items ),
+                                     send_fd( -1 ),
+                                     recv_fd( -1 )
+   {
+      connect_loopback();
+      sender   = std::thread( &TcpBridge::send_loop, this );
+      receiver = std::thread( &TcpBridge::recv_loop, this );
+   }
+
+   ~TcpBridge()
+   {
+      sender.join();
+      receiver.join();
+      close( send_fd );
+      close( recv_fd );
+   }
+
+private:
+   static void fail( const char *message )
+   {
+      perror( message );
+      exit( EXIT_FAILURE );
+   }
+
+   void connect_loopback()
+   {
+      const int listener( socket( AF_INET, SOCK_STREAM, 0 ) );
+      if( listener < 0 )
+      {
+         fail( "Failed to create TCP socket" );
+      }
+      struct sockaddr_in address;
+      std::memset( &address, 0, sizeof( address ) );
+      address.sin_family      = AF_INET;
+      address.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+      address.sin_port        = 0;
+      socklen_t length( sizeof( address ) );
+      if( bind( listener, (struct sockaddr*) &address, length ) != 0 ||
+          listen( listener, 1 ) != 0 ||
+          getsockname( listener, (struct sockaddr*) &address, &length ) != 0 )
+      {
+         fail( "Failed to listen on loopback" );
+      }
+      send_fd = socket( AF_INET, SOCK_STREAM, 0 );
+      if( send_fd < 0 ||
+          connect( send_fd, (struct sockaddr*) &address, length ) != 0 )
+      {
+         fail( "Failed to connect over loopback" );
+      }
+      recv_fd = accept( listener, nullptr, nullptr );
+      if( recv_fd < 0 )
+      {
+         fail( "Failed to accept loopback connection" );
+      }
+      close( listener );
+      const int one( 1 );
+      setsockopt( send_fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof( one ) );
+   }
+
+   void send_loop()
+   {
+      const size_t max_batch( 64 );
+      std::vector< T > batch( max_batch );
+      size_t sent( 0 );
+      while( sent < items )
+      {
+         /** block for one, then take whatever else is there **/
+         in.pop( batch[ 0 ] );
+         size_t n( 1 );
+         const size_t avail( std::min( in.size(), max_batch - 1 ) );
+         for( size_t i( 0 ); i < avail; i++ )
+         {
+            in.pop( batch[ n++ ] );
+         }
+         const char *ptr( reinterpret_cast< const char* >( batch.data() ) );
+         size_t remaining( n * sizeof( T ) );
+         while( remaining > 0 )
+         {
+            const ssize_t count( write( send_fd, ptr, remaining ) );
+            if( count < 0 )
+            {
+               if( errno == EINTR )
+               {
+                  continue;
+               }
+               fail( "Failed to write to loopback" );
+            }
+            ptr       += count;
+            remaining -= count;
+         }
+         sent += n;
+      }
+   }
+
+   void recv_loop()
+   {
+      const size_t max_batch( 64 );
+      std::vector< T > batch( max_batch );
+      char *base( reinterpret_cast< char* >( batch.data() ) );
+      size_t have( 0 );
+      size_t received( 0 );
+      while( received < items )
+      {
+         const ssize_t count( read( recv_fd,
+                                    base + have,
+                                    ( max_batch * sizeof( T ) ) - have ) );
+         if( count <= 0 )
+         {
+            if( count < 0 && errno == EINTR )
+            {
+               continue;
+            }
+            fail( "Failed to read from loopback" );
+         }
+         have += count;
+         const size_t whole( have / sizeof( T ) );
+         for( size_t i( 0 ); i < whole; i++ )
+         {
+            received++;
+            out.push( batch[ i ], ( received == items ? RBSignal::RBEOF :
+                                                        RBSignal::NONE ) );
+         }
+         /** keep any partial item for the next read **/
+         const size_t used( whole * sizeof( T ) );
+         std::memmove( base, base + used, have - used );
+         have -= used;
+      }
+   }
+
+   RingBuffer< T >  &in;
+   RingBuffer< T >  &out;
+   const size_t      items;
+   int               send_fd;
+   int               recv_fd;
+   std::thread       sender;
+   std::thread       receiver;
+};
+
+/**
+ * run_throughput - one producer, one consumer, config.items items
+ * of element type T over the configured backing.  SharedMemory
+ * runs both ends as threads of this process, each with its own
+ * mapping of the segments, which is what a second process would
+ * see apart from the page tables.
+ * @return Result
+ */
+template < class T >
+static Result run_throughput( const Config &config )
+{
+   Result result;
+   StartLine start_line( 2 );
+   std::atomic< std::uint64_t > end( 0 );
+   auto producer_side = [&]( RingBufferBase< T, RingBufferType::Heap > *heap,
+                             RingBufferBase< T, RingBufferType::SharedMemory > *shm )
+   {
+      if( config.producer_cpu >= 0 )
+      {
+         Affinity::pin( config.producer_cpu );
+      }
+      /** open before the start line, the syscalls aren't free **/
+      PerfCounters *counters( config.counters ? new PerfCounters() : nullptr );
+      start_line.arrive();
+      if( counters != nullptr )
+      {
+         counters->start();
+      }
+      if( heap != nullptr )
+      {
+         produce( *heap, config );
+      }
+      else
+      {
+         produce( *shm, config );
+      }
+      if( counters != nullptr )
+      {
+         counters->stop( result.producer_counters );
+         delete( counters );
+      }
+   };
+   auto consumer_side = [&]( RingBufferBase< T, RingBufferType::Heap > *heap,
+                             RingBufferBase< T, RingBufferType::SharedMemory > *shm )
+   {
+      if( config.consumer_cpu >= 0 )
+      {
+         Affinity::pin( config.consumer_cpu );
+      }
+      PerfCounters *counters( config.counters ? new PerfCounters() : nullptr );
+      start_line.arrive();
+      if( counters != nullptr )
+      {
+         counters->start();
+      }
+      result.in_order = ( heap != nullptr ? consume( *heap, config ) :
+                                            consume( *shm, config ) );
+      end.store( system_clock->getNanoseconds(), std::memory_order_release );
+      if( counters != nullptr )
+      {
+         counters->stop( result.consumer_counters );
+         delete( counters );
+      }
+   };
+   switch( config.backing )
+   {
+      case( RingBufferType::Heap ):
+      {
+         RingBuffer< T > queue( config.capacity );
+         queue.defer_publication( std::min( config.defer, config.capacity ) );
+         std::thread producer( producer_side, &queue, nullptr );
+         std::thread consumer( consumer_side, &queue, nullptr );
+         producer.join();
+         consumer.join();
+      }
+      break;
+      case( RingBufferType::SharedMemory ):
+      {
+         QueueRegistry registry;
+         const std::string name( queue_name( "data" ) );
+         /** the Data constructors handshake, so build each end in its own thread **/
+         std::thread producer( [&]()
+         {
+            RingBuffer< T, RingBufferType::SharedMemory > *queue(
+               registry.create< T >( name, config.capacity ) );
+            queue->defer_publication( std::min( config.defer, config.capacity ) );
+            producer_side( nullptr, queue );
+            /** keep the mapping till the consumer has drained it **/
+            while( end.load( std::memory_order_acquire ) == 0 )
+            {
+               std::this_thread::yield();
+            }
+            registry.withdraw( name );
+            delete( queue );
+         } );
+         std::thread consumer( [&]()
+         {
+            RingBuffer< T, RingBufferType::SharedMemory > *queue(
+               registry.attach< T >( name ) );
+            queue->defer_publication( std::min( config.defer, config.capacity ) );
+            consumer_side( nullptr, queue );
+            delete( queue );
+         } );
+         producer.join();
+         consumer.join();
+      }
+      break;
+      case( RingBufferType::TCP ):
+      {
+         RingBuffer< T > to_socket( config.capacity );
+         RingBuffer< T > from_socket( config.capacity );
+         to_socket.defer_publication( std::min( config.defer, config.capacity ) );
+         from_socket.defer_publication( std::min( config.defer, config.capacity ) );
+         TcpBridge< T > *bridge( new TcpBridge< T >( to_socket,
+                                                     from_socket,
+                                                     config.items ) );
+         std::thread producer( producer_side, &to_socket, nullptr );
+         std::thread consumer( consumer_side, &from_socket, nullptr );
+         producer.join();
+         consumer.join();
+         delete( bridge );
+      }
+      break;
+      default:
+      {
+         std::cerr << "Unsupported backing for benchmark, exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+   result.items   = config.items;
+   result.seconds = (double) ( end.load() - start_line.started() ) * 1.0e-9;
+   return( result );
+}
+
+/**
+ * produce_blocks / consume_blocks - zero copy versions of produce
+ * and consume, the sequence number goes in the block and only the
+ * handle is queued.
+ */
+template < RingBufferType type >
+static void produce_blocks( SlabChannel< type > &channel,
+                            const Config &config )
+{
+   Waiter waiter( channel.queue(), Interest::Writable, config.wait );
+   for( std::uint64_t sequence( 0 ); sequence < config.items; sequence++ )
+   {
+      Slab::Handle handle( 0 );
+      void *block( channel.allocate( config.element_size, handle ) );
+      if( block == nullptr )
+      {
+         return;
+      }
+      std::memcpy( block, &sequence, sizeof( sequence ) );
+      while( channel.queue().space_avail() == 0 )
+      {
+         waiter.wait();
+      }
+      channel.send( handle, ( sequence + 1 == config.items ? RBSignal::RBEOF :
+                                                             RBSignal::NONE ) );
+   }
+}
+
+template < RingBufferType type >
+static bool consume_blocks( SlabChannel< type > &channel,
+                            const Config &config )
+{
+   Waiter waiter( channel.queue(), Interest::Readable, config.wait );
+   bool in_order( true );
+   std::uint64_t expected( 0 );
+   while( expected < config.items )
+   {
+      while( channel.queue().size() == 0 && ! channel.queue().closed() )
+      {
+         waiter.wait();
+      }
+      Slab::Handle handle( 0 );
+      const void *block( channel.receive( handle ) );
+      if( block == nullptr )
+      {
+         return( false );
+      }
+      std::uint64_t sequence( 0 );
+      std::memcpy( &sequence, block, sizeof( sequence ) );
+      in_order = in_order && ( sequence == expected );
+      expected++;
+      channel.done( handle );
+   }
+   return( in_order );
+}
+
+/**
+ * run_zero_copy - run_throughput with config.element_size byte
+ * payloads moved through a SlabChannel, Heap and SharedMemory
+ * backings only.  The slab has a block for every handle that can
+ * be queued either way so the producer never waits on returns.
+ * @return Result
+ */
+static inline Result run_zero_copy( const Config &config )
+{
+   Result result;
+   StartLine start_line( 2 );
+   std::atomic< std::uint64_t > end( 0 );
+   const std::vector< Slab::SizeClass > classes( 1,
+      Slab::SizeClass( config.element_size, ( 2 * config.capacity ) + 2 ) );
+   auto producer_side = [&]( SlabChannel< RingBufferType::Heap > *heap,
+                             SlabChannel< RingBufferType::SharedMemory > *shm )
+   {
+      if( config.producer_cpu >= 0 )
+      {
+         Affinity::pin( config.producer_cpu );
+      }
+      PerfCounters *counters( config.counters ? new PerfCounters() : nullptr );
+      start_line.arrive();
+      if( counters != nullptr )
+      {
+         counters->start();
+      }
+      if( heap != nullptr )
+      {
+         produce_blocks( *heap, config );
+      }
+      else
+      {
+         produce_blocks( *shm, config );
+      }
+      if( counters != nullptr )
+      {
+         counters->stop( result.producer_counters );
+         delete( counters );
+      }
+   };
+   auto consumer_side = [&]( SlabChannel< RingBufferType::Heap > *heap,
+                             SlabChannel< RingBufferType::SharedMemory > *shm )
+   {
+      if( config.consumer_cpu >= 0 )
+      {
+         Affinity::pin( config.consumer_cpu );
+      }
+      PerfCounters *counters( config.counters ? new PerfCounters() : nullptr );
+      start_line.arrive();
+      if( counters != nullptr )
+      {
+         counters->start();
+      }
+      result.in_order = ( heap != nullptr ? consume_blocks( *heap, config ) :
+                                            consume_blocks( *shm, config ) );
+      end.store( system_clock->getNanoseconds(), std::memory_order_release );
+      if( counters != nullptr )
+      {
+         counters->stop( result.consumer_counters );
+         delete( counters );
+      }
+   };
+   switch( config.backing )
+   {
+      case( RingBufferType::Heap ):
+      {
+         SlabChannel< RingBufferType::Heap > channel( classes, config.capacity );
+         std::thread producer( producer_side, &channel, nullptr );
+         std::thread consumer( consumer_side, &channel, nullptr );
+         producer.join();
+         consumer.join();
+      }
+      break;
+      case( RingBufferType::SharedMemory ):
+      {
+         QueueRegistry registry;
+         const std::string name( queue_name( "blocks" ) );
+         std::thread producer( [&]()
+         {
+            /** the registry key prefixes all three of the channel's segments **/
+            const std::string key( registry.publish( name,
+               QueueRegistry::Layout::of< Slab::Handle >( config.capacity ) ) );
+            SlabChannel< RingBufferType::SharedMemory > channel( classes,
+                                                                 config.capacity,
+                                                                 key,
+                                                                 Direction::Producer );
+            producer_side( nullptr, &channel );
+            /** keep the mapping till the consumer has drained it **/
+            while( end.load( std::memory_order_acquire ) == 0 )
+            {
+               std::this_thread::yield();
+            }
+            registry.withdraw( name );
+         } );
+         std::thread consumer( [&]()
+         {
+            QueueRegistry::Info info;
+            registry.wait_for( name, info );
+            SlabChannel< RingBufferType::SharedMemory > channel( classes,
+                                                                 info.layout.capacity,
+                                                                 info.key,
+                                                                 Direction::Consumer );
+            consumer_side( nullptr, &channel );
+         } );
+         producer.join();
+         consumer.join();
+      }
+      break;
+      default:
+      {
+         std::cerr << "Zero copy runs need a heap or shm backing, exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+   result.items   = config.items;
+   result.seconds = (double) ( end.load() - start_line.started() ) * 1.0e-9;
+   return( result );
+}
+
+/**
+ * ping - client side of a round trip run, sends one item at a time
+ * on request and waits for it to come back on response.  The first
+ * warmup round trips aren't recorded.
+ */
+template < class T, RingBufferType request_type, RingBufferType response_type >
+static void ping( RingBufferBase< T, request_type >  &request,
+                  RingBufferBase< T, response_type > &response,
+                  const Config &config,
+                  const size_t warmup,
+                  Histogram &latency )
+{
+   Waiter waiter( response, Interest::Readable, config.wait );
+   T item;
+   std::memset( &item, 0, sizeof( T ) );
+   for( std::uint64_t i( 0 ); i < warmup + config.items; i++ )
+   {
+      std::memcpy( item.bytes, &i, sizeof( i ) );
+      const std::uint64_t start( system_clock->getNanoseconds() );
+      request.push( item );
+      while( response.size() == 0 )
+      {
+         waiter.wait();
+      }
+      response.pop( item );
+      const std::uint64_t end( system_clock->getNanoseconds() );
+      if( i >= warmup )
+      {
+         latency.record( end - start );
+      }
+   }
+}
+
+/**
+ * pong - server side of a round trip run, echoes every item.
+ */
+template < class T, RingBufferType request_type, RingBufferType response_type >
+static void pong( RingBufferBase< T, request_type >  &request,
+                  RingBufferBase< T, response_type > &response,
+                  const Config &config,
+                  const size_t total )
+{
+   Waiter waiter( request, Interest::Readable, config.wait );
+   T item;
+   for( size_t i( 0 ); i < total; i++ )
+   {
+      while( request.size() == 0 )
+      {
+         waiter.wait();
+      }
+      request.pop( item );
+      response.push( item );
+   }
+}
+
+/**
+ * run_pingpong - round trip latency between a client pinned to
+ * config.producer_cpu and an echo server pinned to
+ * config.consumer_cpu, config.items round trips after warmup.
+ * Heap runs the two as threads, SharedMemory forks the server
+ * into its own process (waited on with ProcWait) and TCP puts a
+ * loopback bridge in each direction.
+ * @param latency - Histogram&, round trip times in ns
+ */
+template < class T >
+static void run_pingpong( const Config &config,
+                          const size_t warmup,
+                          Histogram &latency )
+{
+   const size_t total( warmup + config.items );
+   auto client = [&]( RingBufferBase< T, RingBufferType::Heap > &request,
+                      RingBufferBase< T, RingBufferType::Heap > &response )
+   {
+      if( config.producer_cpu >= 0 )
+      {
+         Affinity::pin( config.producer_cpu );
+      }
+      ping( request, response, config, warmup, latency );
+   };
+   auto server = [&]( RingBufferBase< T, RingBufferType::Heap > &request,
+                      RingBufferBase< T, RingBufferType::Heap > &response )
+   {
+      if( config.consumer_cpu >= 0 )
+      {
+         Affinity::pin( config.consumer_cpu );
+      }
+      pong( request, response, config, total );
+   };
+   switch( config.backing )
+   {
+      case( RingBufferType::Heap ):
+      {
+         RingBuffer< T > request( config.capacity );
+         RingBuffer< T > response( config.capacity );
+         std::thread echo( server, std::ref( request ), std::ref( response ) );
+         std::thread sender( client, std::ref( request ), std::ref( response ) );
+         sender.join();
+         echo.join();
+      }
+      break;
+      case( RingBufferType::SharedMemory ):
+      {
+         QueueRegistry registry;
+         const std::string request_name( queue_name( "request" ) );
+         const std::string response_name( queue_name( "response" ) );
+         /** don't let the child flush our buffered output a second time **/
+         std::cout.flush();
+         std::cerr.flush();
+         ProcWait *proc_wait( new ProcWait( 1 ) );
+         const pid_t child( fork() );
+         switch( child )
+         {
+            case( 0 /* CHILD */ ):
+            {
+               if( config.consumer_cpu >= 0 )
+               {
+                  Affinity::pin( config.consumer_cpu );
+               }
+               /** same construction order as the parent or the handshakes deadlock **/
+               RingBuffer< T, RingBufferType::SharedMemory > *request(
+                  registry.attach< T >( request_name ) );
+               RingBuffer< T, RingBufferType::SharedMemory > *response(
+                  registry.create< T >( response_name, config.capacity ) );
+               pong( *request, *response, config, total );
+               registry.withdraw( response_name );
+               exit( EXIT_SUCCESS );
+            }
+            break;
+            case( -1 /* failed to fork */ ):
+            {
+               std::cerr << "Failed to fork, exiting!!\n";
+               exit( EXIT_FAILURE );
+            }
+            break;
+            default: /* parent */
+            {
+               proc_wait->AddProcess( child );
+               std::thread sender( [&]()
+               {
+                  if( config.producer_cpu >= 0 )
+                  {
+                     Affinity::pin( config.producer_cpu );
+                  }
+                  RingBuffer< T, RingBufferType::SharedMemory > *request(
+                     registry.create< T >( request_name, config.capacity ) );
+                  RingBuffer< T, RingBufferType::SharedMemory > *response(
+                     registry.attach< T >( response_name ) );
+                  ping( *request, *response, config, warmup, latency );
+                  /** the server has seen the last request once we have its reply **/
+                  proc_wait->WaitForChildren();
+                  registry.withdraw( request_name );
+                  delete( request );
+                  delete( response );
+               } );
+               sender.join();
+            }
+         }
+         delete( proc_wait );
+      }
+      break;
+      case( RingBufferType::TCP ):
+      {
+         RingBuffer< T > client_out( config.capacity );
+         RingBuffer< T > server_in( config.capacity );
+         RingBuffer< T > server_out( config.capacity );
+         RingBuffer< T > client_in( config.capacity );
+         TcpBridge< T > *to_server( new TcpBridge< T >( client_out, server_in, total ) );
+         TcpBridge< T > *to_client( new TcpBridge< T >( server_out, client_in, total ) );
+         std::thread echo( server, std::ref( server_in ), std::ref( server_out ) );
+         std::thread sender( client, std::ref( client_out ), std::ref( client_in ) );
+         sender.join();
+         echo.join();
+         delete( to_server );
+         delete( to_client );
+      }
+      break;
+      default:
+      {
+         std::cerr << "Unsupported backing for benchmark, exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+}
+
+/**
+ * core_pairs - every unordered pair of online cpus, what the
+ * tools sweep when no pairs are given.  A single unpinned pair
+ * on a machine with one cpu.
+ */
+static inline std::vector< std::pair< int, int > > core_pairs()
+{
+   const std::vector< int > cpus( SystemInfo::getTopology().getCPUs() );
+   std::vector< std::pair< int, int > > pairs;
+   for( size_t i( 0 ); i < cpus.size(); i++ )
+   {
+      for( size_t j( i + 1 ); j < cpus.size(); j++ )
+      {
+         pairs.push_back( std::make_pair( cpus[ i ], cpus[ j ] ) );
+      }
+   }
+   if( pairs.size() == 0 )
+   {
+      pairs.push_back( std::make_pair( -1, -1 ) );
+   }
+   return( pairs );
+}
+
+/** split a comma separated command line list **/
+static inline std::vector< std::string > split( const std::string &list )
+{
+   std::vector< std::string > out;
+   std::stringstream ss( list );
+   std::string token;
+   while( std::getline( ss, token, ',' ) )
+   {
+      if( token.length() > 0 )
+      {
+         out.push_back( token );
+      }
+   }
+   return( out );
+}
+
+static inline std::vector< size_t > split_sizes( const std::string &list )
+{
+   std::vector< size_t > out;
+   for( const std::string &token : split( list ) )
+   {
+      out.push_back( (size_t) std::strtoull( token.c_str(), nullptr, 10 ) );
+   }
+   return( out );
+}
+
+/**
+ * split_pairs - "a:b,c:d" into core pairs, "auto" is the closest
+ * cache sharing pair from Placement::Auto().
+ * @return bool - false if the list is malformed
+ */
+static inline bool split_pairs( const std::string &list,
+                                std::vector< std::pair< int, int > > &pairs )
+{
+   pairs.clear();
+   for( const std::string &pair : split( list ) )
+   {
+      if( pair == "auto" )
+      {
+         const Placement placement( Placement::Auto() );
+         pairs.push_back( std::make_pair( placement.producer_cpu,
+                                          placement.consumer_cpu ) );
+         continue;
+      }
+      const size_t colon( pair.find( ':' ) );
+      if( colon == std::string::npos )
+      {
+         return( false );
+      }
+      pairs.push_back( std::make_pair( atoi( pair.substr( 0, colon ).c_str() ),
+                                       atoi( pair.substr( colon + 1 ).c_str() ) ) );
+   }
+   return( true );
+}
+
+/** names used on the command line and in the output **/
+static inline const char* backing_name( const RingBufferType backing )
+{
+   switch( backing )
+   {
+      case( RingBufferType::Heap ):          return( "heap" );
+      case( RingBufferType::SharedMemory ):  return( "shm" );
+      case( RingBufferType::TCP ):           return( "tcp" );
+      default:                               return( "unknown" );
+   }
+}
+
+static inline bool parse_backing( const std::string &name,
+                                  RingBufferType &backing )
+{
+   if(      name == "heap" ) backing = RingBufferType::Heap;
+   else if( name == "shm"  ) backing = RingBufferType::SharedMemory;
+   else if( name == "tcp"  ) backing = RingBufferType::TCP;
+   else return( false );
+   return( true );
+}
+
+static inline bool parse_wait( const std::string &name,
+                               WaitStrategy &wait )
+{
+   if(      name == "spin"  ) wait = WaitStrategy::Spin;
+   else if( name == "yield" ) wait = WaitStrategy::Yield;
+   else if( name == "block" ) wait = WaitStrategy::Block;
+   else return( false );
+   return( true );
+}
+
+static inline const char* wait_name( const WaitStrategy wait )
+{
+   switch( wait )
+   {
+      case( WaitStrategy::Spin ):   return( "spin" );
+      case( WaitStrategy::Yield ):  return( "yield" );
+      case( WaitStrategy::Block ):  return( "block" );
+      default:                      return( "unknown" );
+   }
+}
+
+} /** end namespace Bench **/
+#endif /* END _BENCHMARK_TCC_ */
@@ -19,14 +19,20 @@
  */
 #ifndef _BUFFERDATA_TCC_
 #define _BUFFERDATA_TCC_  1
+#include <atomic>
+#include <chrono>
 #include <cstdint>
 #include <cstring>
 #include <cassert>
 #include <thread>
+#include <new>
 #include "shm.hpp"
 #include "signalvars.hpp"
 #include "pointer.hpp"
 #include "ringbuffertypes.hpp"
+#include "affinity.hpp"
+#include "rbprobes.hpp"
+#include "region.tcc"
 
 namespace Buffer
 {
@@ -68,9 +74,120 @@ struct Signal
    Signal( const Signal &other )
    {
       (this)->sig = other.sig;
+#if RB_META_ENABLED
+      (this)->meta = other.meta;
+#endif
    }
 
    RBSignal sig;
+#if RB_META_ENABLED
+   /** only there if some RB_META_* field is, see signalvars.hpp **/
+   SlotMeta meta;
+#endif
+};
+
+/**
+ * Control - per queue words shared by both ends that aren't
+ * part of the read/write pointers.  The epochs are futex words
+ * bumped by the producer (data) and consumer (space) whenever
+ * the matching waiter count is non-zero, letting a QueueSet
+ * sleep on many queues at once instead of polling size().
+ * Neither end looks at the waiter counts unless watched says
+ * a QueueSet or executor stage has the queue.
+ * All zero is the initial state so it is valid in fresh SHM.
+ */
+struct Control
+{
+   Control() : data_epoch( 0 ),
+               data_waiters( 0 ),
+               space_epoch( 0 ),
+               space_waiters( 0 ),
+               closed( 0 ),
+               abandoned( 0 ),
+               watched( 0 ),
+               signal_head( 0 ),
+               signal_tail( 0 )
+   {
+      for( std::uint32_t i( 0 ); i < signal_slots; i++ )
+      {
+         signals[ i ].store( RBSignal::NONE, std::memory_order_relaxed );
+      }
+   }
+
+   /**
+    * push_signal / pop_signal - the out of band signal ring, one
+    * sender and one receiver.  Never blocks, push_signal returns
+    * false when signal_slots are already waiting and pop_signal
+    * returns NONE when nothing is.
+    */
+   bool push_signal( const RBSignal signal )
+   {
+      const std::uint32_t head( signal_head.load( std::memory_order_relaxed ) );
+      if( head - signal_tail.load( std::memory_order_acquire ) >= signal_slots )
+      {
+         return( false );
+      }
+      signals[ head % signal_slots ].store( signal, std::memory_order_relaxed );
+      signal_head.store( head + 1, std::memory_order_release );
+      return( true );
+   }
+
+   RBSignal pop_signal()
+   {
+      const std::uint32_t tail( signal_tail.load( std::memory_order_relaxed ) );
+      if( tail == signal_head.load( std::memory_order_acquire ) )
+      {
+         return( RBSignal::NONE );
+      }
+      const RBSignal signal( (RBSignal) 
+         signals[ tail % signal_slots ].load( std::memory_order_relaxed ) );
+      signal_tail.store( tail + 1, std::memory_order_release );
+      return( signal );
+   }
+
+   bool signal_pending() const
+   {
+      return( signal_head.load( std::memory_order_acquire ) !=
+              signal_tail.load( std::memory_order_relaxed ) );
+   }
+
+   static const std::uint32_t signal_slots = 8;
+
+   alignas( 64 ) std::atomic< std::uint32_t >   data_epoch;
+   std::atomic< std::uint32_t >                 data_waiters;
+   alignas( 64 ) std::atomic< std::uint32_t >   space_epoch;
+   std::atomic< std::uint32_t >                 space_waiters;
+   /**
+    * end of stream, written once each so both ends keep the line
+    * shared.  closed by the producer, abandoned by the consumer.
+    * watched counts the QueueSets and parked executor stages on
+    * this queue, only written as they come and go.
+    */
+   alignas( 64 ) std::atomic< std::uint32_t >   closed;
+   std::atomic< std::uint32_t >                 abandoned;
+   std::atomic< std::uint32_t >                 watched;
+   /**
+    * out of band signals, see RingBufferBase::send_signal().  Only
+    * written when a signal is sent or taken, so checking for one
+    * between items is a load of a line that stays shared.
+    */
+   alignas( 64 ) std::atomic< std::uint32_t >   signal_head;
+   std::atomic< std::uint32_t >                 signal_tail;
+   std::atomic< std::uint32_t >                 signals[ signal_slots ];
+};
+
+/**
+ * Carved - where one queue's pieces already sit in memory owned
+ * by someone else (see QueueArena).  The owner constructs the
+ * Pointers and Control, a Data built from it frees nothing.
+ */
+struct Carved
+{
+   Pointer  *read_pt;
+   Pointer  *write_pt;
+   Control  *control;
+   Signal   *signal;
+   void     *store;
 };
 
 /**
@@ -82,17 +199,51 @@ template < class T > struct DataBase
 {
    DataBase( const size_t max_cap ) : read_pt ( nullptr ),
                                       write_pt( nullptr ),
+                                      control ( nullptr ),
                                       max_cap ( max_cap ),
                                       store   ( nullptr ),
-                                      signal  ( nullptr )
+                                      signal  ( nullptr ),
+                                      carved  ( false )
    {
 
       length_store   = ( sizeof( Element< T > ) * max_cap ); 
       length_signal  = ( sizeof( Signal ) * max_cap );
    }
 
+   DataBase( const size_t max_cap,
+             const Carved &pieces ) : read_pt ( pieces.read_pt ),
+                                      write_pt( pieces.write_pt ),
+                                      control ( pieces.control ),
+                                      max_cap ( max_cap ),
+                                      store   ( reinterpret_cast< Element< T >* >(
+                                                   pieces.store ) ),
+                                      signal  ( pieces.signal ),
+                                      carved  ( true )
+   {
+      length_store   = ( sizeof( Element< T > ) * max_cap ); 
+      length_signal  = ( sizeof( Signal ) * max_cap );
+   }
+
+   /**
+    * bind - bind the store, signal, pointers and control lines
+    * to a NUMA node, anything already touched gets migrated.
+    * Binding works on whole pages so each piece must own the
+    * pages it sits in: SHM segments are their own mappings, a
+    * Heap queue has to come from the paged Data constructor.
+    * @param node - const int
+    */
+   void bind( const int node )
+   {
+      Affinity::bindMemory( store,    length_store,      node );
+      Affinity::bindMemory( signal,   length_signal,     node );
+      Affinity::bindMemory( read_pt,  sizeof( Pointer ), node );
+      Affinity::bindMemory( write_pt, sizeof( Pointer ), node );
+      Affinity::bindMemory( control,  sizeof( Control ), node );
+   }
+
    Pointer           *read_pt;
    Pointer           *write_pt;
+   Control           *control;
    size_t             max_cap;
    /** 
     * allocating these as structs gives a bit
@@ -107,6 +258,8 @@ template < class T > struct DataBase
    Signal            *signal;
    size_t             length_store;
    size_t             length_signal;
+   /** true if the memory belongs to a QueueArena **/
+   const bool         carved;
 };
 
 template < class T, 
@@ -115,8 +268,14 @@ template < class T,
 {
 
 
-   Data( size_t max_cap , const size_t align = 16 ) : DataBase< T >( max_cap )
+   Data( size_t max_cap , const size_t align = 16 ) : DataBase< T >( max_cap ),
+                                                      paged( align >= Affinity::pageSize() )
    {
+      if( paged )
+      {
+         allocate_paged();
+         return;
+      }
       int ret_val( posix_memalign( (void**)&((this)->store), 
                                    align, 
                                    (this)->length_store ) );
@@ -139,14 +298,49 @@ template < class T,
       /** TODO, see if there are optimizations to be made with sizing and alignment **/
       (this)->read_pt   = new Pointer( max_cap );
       (this)->write_pt  = new Pointer( max_cap ); 
+      /** control words get their own cache lines **/
+      void *control_mem( nullptr );
+      ret_val = posix_memalign( &control_mem, 64, sizeof( Control ) );
+      if( ret_val != 0 )
+      {
+         std::cerr << "posix_memalign returned error code (" << ret_val << ")";
+         std::cerr << " with message: \n" << strerror( ret_val ) << "\n";
+         exit( EXIT_FAILURE );
+      }
+      (this)->control = new ( control_mem ) Control();
+   }
+
+   /**
+    * Data - view of a queue carved from someone else's memory.
+    * @param pieces  - const Carved&
+    * @param max_cap - size_t
+    */
+   Data( const Carved &pieces, size_t max_cap ) : DataBase< T >( max_cap, pieces ),
+                                                  paged( false )
+   {
    }
 
 
    ~Data()
    {
+      if( (this)->carved )
+      {
+         return;
+      }
+      if( paged )
+      {
+         (this)->control->~Control();
+         /** pointers and control share one block starting at read_pt **/
+         free( (this)->read_pt );
+         free( (this)->store );
+         free( (this)->signal );
+         return;
+      }
       //DELETE USED HERE
       delete( (this)->read_pt );
       delete( (this)->write_pt );
+      (this)->control->~Control();
+      free( (this)->control );
 
       //FREE USED HERE
       std::memset( (this)->store, 0, ( sizeof( Element< T > ) * (this)->max_cap ) );
@@ -155,6 +349,51 @@ template < class T,
       free( (this)->signal );
    }
 
+private:
+   /** page aligned, page rounded, bind() moves nothing else **/
+   static void* alloc_pages( const size_t length )
+   {
+      const size_t page( Affinity::pageSize() );
+      void *out( nullptr );
+      const int ret_val( posix_memalign( &out,
+                                         page,
+                                         ( ( length + page - 1 ) / page ) * page ) );
+      if( ret_val != 0 )
+      {
+         std::cerr << "posix_memalign returned error code (" << ret_val << ")";
+         std::cerr << " with message: \n" << strerror( ret_val ) << "\n";
+         exit( EXIT_FAILURE );
+      }
+      return( out );
+   }
+
+   /**
+    * allocate_paged - the placement layout, the store and signal
+    * arrays each get pages of their own and the two pointers and
+    * the control block share one more (each on its own line), so
+    * binding the queue to a node never drags unrelated heap data
+    * along with it.
+    */
+   void allocate_paged()
+   {
+      (this)->store  = reinterpret_cast< Element< T >* >(
+         alloc_pages( (this)->length_store ) );
+      (this)->signal = reinterpret_cast< Signal* >(
+         alloc_pages( (this)->length_signal ) );
+      std::memset( (void*) (this)->signal, 0, (this)->length_signal );
+      char *block( reinterpret_cast< char* >(
+         alloc_pages( control_offset + sizeof( Control ) ) ) );
+      (this)->read_pt  = new ( block ) Pointer( (this)->max_cap );
+      (this)->write_pt = new ( block + line ) Pointer( (this)->max_cap );
+      (this)->control  = new ( block + control_offset ) Control();
+   }
+
+   static const size_t line           = 64;
+   static const size_t control_offset = 2 * line;
+   static_assert( sizeof( Pointer ) <= line, "Pointer must fit in a cache line" );
+
+   /** true if built by the placement constructor **/
+   const bool paged;
 };
 
 template < class T > struct Data< T, RingBufferType::SharedMemory > : 
@@ -177,7 +416,9 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
          const size_t alignment ) : DataBase< T >( max_cap ),
                                     store_key( shm_key + "_store" ),
                                     signal_key( shm_key + "_key" ),
-                                    ptr_key( shm_key + "_ptr" )
+                                    ptr_key( shm_key + "_ptr" ),
+                                    region( nullptr ),
+                                    stamps( nullptr )
    {
       /** now work through opening SHM **/
       switch( dir )
@@ -207,16 +448,16 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
                               (this)->length_signal, 
                               signal_key.c_str() );
             alloc_with_error( (void**)&(this)->read_pt, 
-                              (sizeof( Pointer ) * 2 ) + sizeof( Cookie ), 
+                              ptr_length(), 
                               ptr_key.c_str() );
 
             (this)->write_pt = &(this)->read_pt[ 1 ];
             
-            Pointer temp( max_cap );
-            std::memcpy( (this)->read_pt,  &temp, sizeof( Pointer ) );
-            std::memcpy( (this)->write_pt, &temp, sizeof( Pointer ) );
+            new ( (this)->read_pt  ) Pointer( max_cap );
+            new ( (this)->write_pt ) Pointer( max_cap );
             
             (this)->cookie   = (Cookie*) &(this)->read_pt[ 2 ];
+            (this)->control  = new ( control_addr() ) Control();
             (this)->cookie->producer = 0x1337;
             while( (this)->cookie->consumer != 0x1337 )
             {
@@ -226,11 +467,16 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
          break;
          case( Direction::Consumer ):
          {
+            /**
+             * SHM::Open throws until the producer has created and
+             * sized each segment, it never touches them otherwise
+             */
             auto retry_func = [&]( void **ptr, const char *str )
             {
                std::string error_copy;
-               int timeout( 1000 );
-               while( timeout-- )
+               const auto deadline( std::chrono::steady_clock::now() +
+                                    std::chrono::seconds( 10 ) );
+               while( std::chrono::steady_clock::now() < deadline )
                {
                   try
                   {
@@ -238,8 +484,6 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
                   }
                   catch( bad_shm_alloc &ex )
                   {
-                     //do nothing
-                     timeout--;
                      error_copy = ex.what();
                      std::this_thread::yield();
                      continue;
@@ -265,16 +509,21 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
             (this)->write_pt  = &(this)->read_pt[ 1 ];
             assert( (this)->write_pt  != nullptr );
             (this)->cookie    = (Cookie*)&(this)->read_pt[ 2 ]; 
+            /** zeroed by the producer's SHM::Init, don't re-construct **/
+            (this)->control   = reinterpret_cast< Control* >( control_addr() );
             
-            Pointer temp( max_cap );
-            std::memcpy( (this)->read_pt,  &temp, sizeof( Pointer ) );
-            std::memcpy( (this)->write_pt, &temp, sizeof( Pointer ) );
-            
-            (this)->cookie->consumer = 0x1337;
+            /**
+             * the producer zeroes the segment after sizing it, wait
+             * until it's done with it before writing anything here
+             */
             while( (this)->cookie->producer != 0x1337 )
             {
                std::this_thread::yield();
             }
+            new ( (this)->read_pt  ) Pointer( max_cap );
+            new ( (this)->write_pt ) Pointer( max_cap );
+            
+            (this)->cookie->consumer = 0x1337;
          }
          break;
          default:
@@ -285,10 +534,78 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
          }
       }
       /** should be all set now **/
+      RB_PROBE3( shm_attach, this, shm_key.c_str(), dir );
+   }
+
+   /**
+    * Data - view of a queue carved from a SHM QueueArena, the
+    * arena did the handshake and owns the mapping.
+    * @param pieces  - const Carved&
+    * @param max_cap - size_t
+    */
+   Data( const Carved &pieces, size_t max_cap ) : DataBase< T >( max_cap, pieces ),
+                                                  cookie( nullptr ),
+                                                  region( nullptr ),
+                                                  stamps( nullptr )
+   {
+   }
+
+   /**
+    * Data - anonymous (memfd) SHM queue, everything in one segment
+    * so there is a single fd to pass on: the ptr segment layout
+    * below, then signal, store and trace stamp arrays.  The side
+    * that creates it (fd < 0) initializes it all before anyone
+    * else can see the fd, so unlike the keyed constructor there is
+    * no handshake and it doesn't matter which end comes first.
+    * The stamps cost nothing unless trace() touches them.
+    * @param   max_cap - size_t
+    * @param   fd      - const int, < 0 creates, else maps fd
+    * @param   dir     - Direction, for the shm_attach probe
+    */
+   Data( size_t max_cap,
+         const int fd,
+         Direction dir ) : DataBase< T >( max_cap ),
+                           cookie( nullptr ),
+                           region( nullptr ),
+                           stamps( nullptr )
+   {
+      const size_t signal_offset( round_line( ptr_length() ) );
+      const size_t store_offset( signal_offset + round_line( (this)->length_signal ) );
+      const size_t stamp_offset( store_offset + round_line( (this)->length_store ) );
+      region = new Region< RingBufferType::SharedMemory >( 
+         stamp_offset + ( sizeof( std::uint64_t ) * max_cap ), fd );
+      char *base( reinterpret_cast< char* >( region->ptr ) );
+      (this)->read_pt   = reinterpret_cast< Pointer* >( base );
+      (this)->write_pt  = &(this)->read_pt[ 1 ];
+      (this)->cookie    = (Cookie*) &(this)->read_pt[ 2 ];
+      (this)->signal    = reinterpret_cast< Signal* >( base + signal_offset );
+      (this)->store     = reinterpret_cast< Element< T >* >( base + store_offset );
+      stamps            = reinterpret_cast< std::uint64_t* >( base + stamp_offset );
+      if( region->owner )
+      {
+         new ( (this)->read_pt  ) Pointer( max_cap );
+         new ( (this)->write_pt ) Pointer( max_cap );
+         (this)->control = new ( control_addr() ) Control();
+      }
+      else
+      {
+         (this)->control = reinterpret_cast< Control* >( control_addr() );
+      }
+      RB_PROBE3( shm_attach, this, "memfd", dir );
    }
 
    ~Data()
    {
+      if( (this)->carved )
+      {
+         return;
+      }
+      if( region != nullptr )
+      {
+         delete( region );
+         region = nullptr;
+         return;
+      }
       /** three segments of SHM to close **/
       SHM::Close( store_key.c_str(), 
                   (void*) (this)->store, 
@@ -302,7 +619,7 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
                   true );
       SHM::Close( ptr_key.c_str(),   
                   (void*) (this)->read_pt, 
-                  (sizeof( Pointer ) * 2) + sizeof( Cookie ),
+                  ptr_length(),
                   false,
                   true );
    }
@@ -312,12 +629,41 @@ template < class T > struct Data< T, RingBufferType::SharedMemory > :
       int32_t consumer;;
    };
 
+   /**
+    * ptr segment layout: read Pointer, write Pointer, Cookie, then
+    * the Control block starting on its own cache line.
+    */
+   static size_t control_offset()
+   {
+      const size_t used( ( sizeof( Pointer ) * 2 ) + sizeof( Cookie ) );
+      return( ( used + 63 ) & ~( (size_t) 63 ) );
+   }
+
+   static size_t ptr_length()
+   {
+      return( control_offset() + sizeof( Control ) );
+   }
+
+   void* control_addr()
+   {
+      return( reinterpret_cast< char* >( (this)->read_pt ) + 
+                 control_offset() );
+   }
+
+   static size_t round_line( const size_t bytes )
+   {
+      return( ( bytes + 63 ) & ~( (size_t) 63 ) );
+   }
+
    volatile Cookie         *cookie;
 
    /** process local key copies **/
    const std::string store_key; 
    const std::string signal_key;  
    const std::string ptr_key; 
+   /** anonymous queues only, the memfd segment and trace stamps **/
+   Region< RingBufferType::SharedMemory >   *region;
+   std::uint64_t                            *stamps;
 };
 }
 #endif /* END _BUFFERDATA_TCC_ */
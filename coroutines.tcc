@@ -0,0 +1,546 @@
+/**
+ * coroutines.tcc -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 13:05:17 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Notes: the rest of the queue code is C++11, this header is
+ * the only one that needs -std=c++20.  A stage is written as
+ *
+ *    Task stage( RingBuffer< int > &in, RingBuffer< int > &out )
+ *    {
+ *       int v;
+ *       while( co_await async_pop( in, v ) )
+ *       {
+ *          co_await async_push( out, v );
+ *       }
+ *       out.close();
+ *    }
+ *
+ * and handed to an Executor (one thread) or an ExecutorPool
+ * (one executor per thread).  A stage stays on the executor it
+ * was spawned on so each queue end is still only ever touched
+ * by a single thread.
+ */
+#ifndef _COROUTINES_TCC_
+#define _COROUTINES_TCC_  1
+
+#if ! defined( __cpp_impl_coroutine )
+#error "coroutines.tcc requires C++20 coroutines, compile with -std=c++20"
+#endif
+
+#include <coroutine>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <exception>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "ringbufferbase.tcc"
+#include "affinity.hpp"
+#include "futex.hpp"
+#include "spinwait.hpp"
+
+/**
+ * Task - fire and forget coroutine type for a pipeline stage.
+ * Starts suspended, the executor it is spawned on resumes it
+ * and destroys it once it runs off the end.
+ */
+struct Task
+{
+   struct promise_type
+   {
+      Task get_return_object()
+      {
+         return( Task(
+            std::coroutine_handle< promise_type >::from_promise( *this ) ) );
+      }
+
+      std::suspend_always initial_suspend() noexcept { return( std::suspend_always() ); }
+      std::suspend_always final_suspend() noexcept   { return( std::suspend_always() ); }
+      void return_void() {}
+      void unhandled_exception() { std::terminate(); }
+   };
+
+   explicit Task( std::coroutine_handle< promise_type > h ) : handle( h )
+   {
+   }
+
+   Task( Task &&other ) noexcept : handle( other.handle )
+   {
+      other.handle = nullptr;
+   }
+
+   Task( const Task &other ) = delete;
+
+   ~Task()
+   {
+      /** only still set if never spawned **/
+      if( handle )
+      {
+         handle.destroy();
+      }
+   }
+
+   std::coroutine_handle< promise_type > handle;
+};
+
+/**
+ * Executor - single threaded run loop for Tasks.  Runnable
+ * stages are resumed in FIFO order, stages blocked on a queue
+ * are parked with a readiness check and the queue's control
+ * words, and once nothing can run the thread sleeps on all the
+ * parked queues at once the same way QueueSet does.
+ *
+ * The wake words belong to the queues, not the executor, since
+ * the other end may be in another process.  Stages parked on
+ * the same queue end share one waiter registration and one
+ * word, but a single sleep covers at most Futex::maxWaitAny()
+ * (128) distinct words; parked on more queue ends than that the
+ * idle thread polls in short slices instead (see waitAny()).
+ * Every pass over the parked stages re-checks each of them, so
+ * an executor is meant for tens of stages, spread anything
+ * larger over an ExecutorPool.
+ */
+class Executor
+{
+public:
+   /**
+    * Executor - constructor
+    * @param sleep_slice_ns - const std::int64_t, longest single
+    *        sleep when idle, bounds the cost of a missed wakeup.
+    */
+   Executor( const std::int64_t sleep_slice_ns = 1000000 ) :
+      live( 0 ),
+      sleep_slice_ns( sleep_slice_ns )
+   {
+   }
+
+   virtual ~Executor()
+   {
+      /**
+       * the queues these were parked on may already be gone, so
+       * their watched counts stay up, which only costs a fence
+       */
+      for( auto &r : runnable )
+      {
+         r.handle.destroy();
+      }
+      for( auto &p : parked )
+      {
+         p.handle.destroy();
+      }
+   }
+
+   /**
+    * spawn - take ownership of task, it starts on the next run().
+    * @param task - Task&&
+    */
+   void spawn( Task &&task )
+   {
+      assert( task.handle );
+      runnable.push_back(
+         Parked{ task.handle, nullptr, nullptr, nullptr, nullptr, nullptr } );
+      task.handle = nullptr;
+      live++;
+   }
+
+   /**
+    * run - resume stages until every spawned stage has returned.
+    * Stages that never get unblocked keep this from returning.
+    */
+   void run()
+   {
+      Executor *previous( current_executor );
+      current_executor = this;
+      while( live > 0 )
+      {
+         while( ! runnable.empty() )
+         {
+            const Parked next( runnable.front() );
+            runnable.pop_front();
+            /**
+             * stages parked on the same queue end all look ready
+             * for a single item, whichever runs first takes it.
+             * Nothing else touches this end, so ready now means
+             * the awaiter's push / pop won't block.
+             */
+            if( next.ready != nullptr && ! next.ready( next.context ) )
+            {
+               parked.push_back( next );
+               continue;
+            }
+            if( next.watched != nullptr )
+            {
+               next.watched->fetch_sub( 1, std::memory_order_relaxed );
+            }
+            auto handle( next.handle );
+            handle.resume();
+            if( handle.done() )
+            {
+               handle.destroy();
+               live--;
+            }
+         }
+         if( live > 0 && unpark() == 0 )
+         {
+            idle();
+         }
+      }
+      current_executor = previous;
+   }
+
+   /**
+    * park - called from an awaiter on this thread, handle is
+    * resumed once ready( context ) returns true.  The queue is
+    * counted in watched until then so its other end wakes us.
+    * @param handle  - std::coroutine_handle<>
+    * @param ready   - bool (*)( void* ), readiness check
+    * @param context - void*, passed to ready
+    * @param epoch   - futex word bumped when ready may change
+    * @param waiters - waiter count for epoch
+    * @param watched - the queue's Control::watched
+    */
+   void park( std::coroutine_handle<>         handle,
+              bool                          (*ready)( void* ),
+              void                           *context,
+              std::atomic< std::uint32_t >   *epoch,
+              std::atomic< std::uint32_t >   *waiters,
+              std::atomic< std::uint32_t >   *watched )
+   {
+      watched->fetch_add( 1, std::memory_order_seq_cst );
+      parked.push_back(
+         Parked{ handle, ready, context, epoch, waiters, watched } );
+   }
+
+   /**
+    * current - executor running on the calling thread.
+    * @return Executor*, nullptr if none
+    */
+   static Executor* current()
+   {
+      return( current_executor );
+   }
+
+private:
+   struct Parked
+   {
+      std::coroutine_handle<>         handle;
+      bool                          (*ready)( void* );
+      void                           *context;
+      std::atomic< std::uint32_t >   *epoch;
+      std::atomic< std::uint32_t >   *waiters;
+      std::atomic< std::uint32_t >   *watched;
+   };
+
+   /** move every parked stage that can go to runnable **/
+   size_t unpark()
+   {
+      size_t moved( 0 );
+      size_t i( 0 );
+      while( i < parked.size() )
+      {
+         if( parked[ i ].ready( parked[ i ].context ) )
+         {
+            runnable.push_back( parked[ i ] );
+            parked[ i ] = parked.back();
+            parked.pop_back();
+            moved++;
+         }
+         else
+         {
+            i++;
+         }
+      }
+      return( moved );
+   }
+
+   void idle()
+   {
+      const size_t spin( 64 );
+      for( size_t i( 0 ); i < spin; i++ )
+      {
+         if( unpark() > 0 )
+         {
+            return;
+         }
+         spin_pause();
+      }
+      /** one registration per queue end, however many stages wait on it **/
+      watched.clear();
+      for( auto &p : parked )
+      {
+         watched.push_back( std::make_pair( p.epoch, p.waiters ) );
+      }
+      std::sort( watched.begin(), watched.end() );
+      watched.erase( std::unique( watched.begin(), watched.end() ),
+                     watched.end() );
+      words.clear();
+      expected.clear();
+      for( auto &w : watched )
+      {
+         w.second->fetch_add( 1, std::memory_order_seq_cst );
+         words.push_back( w.first );
+         expected.push_back( w.first->load( std::memory_order_acquire ) );
+      }
+      bool any( false );
+      for( auto &p : parked )
+      {
+         if( p.ready( p.context ) )
+         {
+            any = true;
+            break;
+         }
+      }
+      if( ! any )
+      {
+         Futex::waitAny( words.data(),
+                         expected.data(),
+                         words.size(),
+                         sleep_slice_ns );
+      }
+      for( auto &w : watched )
+      {
+         w.second->fetch_sub( 1, std::memory_order_relaxed );
+      }
+   }
+
+   /** ready is nullptr for stages that haven't parked yet **/
+   std::deque< Parked >                         runnable;
+   std::vector< Parked >                        parked;
+   /** scratch for idle(), kept to avoid re-allocating **/
+   std::vector< std::pair< std::atomic< std::uint32_t >*,
+                           std::atomic< std::uint32_t >* > > watched;
+   std::vector< std::atomic< std::uint32_t >* > words;
+   std::vector< std::uint32_t >                 expected;
+   size_t                                       live;
+   const std::int64_t                           sleep_slice_ns;
+
+   static inline thread_local Executor         *current_executor = nullptr;
+};
+
+/**
+ * ExecutorPool - a handful of threads, each with its own
+ * Executor.  Stages are spread round robin at spawn time and
+ * stay put after that.  Threads are pinned to the given cores
+ * (round robin) if any are given.
+ */
+class ExecutorPool
+{
+public:
+   /**
+    * ExecutorPool - constructor
+    * @param nthreads - const size_t
+    * @param cores    - std::vector< int >, optional pinning
+    */
+   ExecutorPool( const size_t nthreads,
+                 const std::vector< int > cores = std::vector< int >() ) :
+      executors( nthreads ),
+      cores( cores ),
+      next( 0 )
+   {
+      assert( nthreads > 0 );
+   }
+
+   virtual ~ExecutorPool() = default;
+
+   /**
+    * spawn - hand task to the next executor, call before run().
+    * @param task - Task&&
+    */
+   void spawn( Task &&task )
+   {
+      executors[ next ].spawn( std::move( task ) );
+      next = ( next + 1 ) % executors.size();
+   }
+
+   /**
+    * spawn_on - hand task to a specific executor, useful to keep
+    * stages that talk through a queue on the same thread.
+    * @param index - const size_t
+    * @param task  - Task&&
+    */
+   void spawn_on( const size_t index, Task &&task )
+   {
+      executors[ index % executors.size() ].spawn( std::move( task ) );
+   }
+
+   /**
+    * run - run every executor on its own thread, returns once
+    * all of them have finished all their stages.
+    */
+   void run()
+   {
+      std::vector< std::thread > threads;
+      for( size_t i( 0 ); i < executors.size(); i++ )
+      {
+         const int core( cores.size() > 0 ? cores[ i % cores.size() ] : -1 );
+         threads.emplace_back( [ this, i, core ]()
+         {
+            if( core >= 0 )
+            {
+               Affinity::pin( core );
+            }
+            executors[ i ].run();
+         } );
+      }
+      for( auto &t : threads )
+      {
+         t.join();
+      }
+   }
+
+   size_t size() const
+   {
+      return( executors.size() );
+   }
+
+private:
+   std::vector< Executor >    executors;
+   const std::vector< int >   cores;
+   size_t                     next;
+};
+
+/**
+ * PopAwaiter - returned by async_pop(), suspends the stage until
+ * the queue has an item, then pops it into item.  The co_await
+ * result is false once the queue is drained, and, if a signal
+ * pointer was given, when an out of band signal arrives (see
+ * pop_or_signal()), item is untouched either way.
+ */
+template < class T, RingBufferType type > struct PopAwaiter
+{
+   RingBufferBase< T, type >  &queue;
+   T                          &item;
+   RBSignal                   *signal;
+
+   static bool ready( void *context )
+   {
+      PopAwaiter *awaiter( reinterpret_cast< PopAwaiter* >( context ) );
+      RingBufferBase< T, type > &q( awaiter->queue );
+      return( q.size() > 0 || q.closed() ||
+              ( awaiter->signal != nullptr && q.signal_pending() ) );
+   }
+
+   bool await_ready()
+   {
+      return( ready( this ) );
+   }
+
+   void await_suspend( std::coroutine_handle<> handle )
+   {
+      Executor *executor( Executor::current() );
+      assert( executor != nullptr );
+      Buffer::Control &control( queue.control() );
+      /** the awaiter lives in the stage's frame until it resumes **/
+      executor->park( handle,
+                      PopAwaiter::ready,
+                      this,
+                      &control.data_epoch,
+                      &control.data_waiters,
+                      &control.watched );
+   }
+
+   bool await_resume()
+   {
+      if( signal == nullptr )
+      {
+         return( queue.pop( item ) );
+      }
+      return( queue.pop_or_signal( item, *signal ) );
+   }
+};
+
+/**
+ * PushAwaiter - returned by async_push(), suspends the stage
+ * until the queue has space, then pushes the item.  The co_await
+ * result is false if the consumer abandoned the queue.
+ */
+template < class T, RingBufferType type > struct PushAwaiter
+{
+   RingBufferBase< T, type >  &queue;
+   T                          &item;
+   const RBSignal              signal;
+
+   static bool ready( void *context )
+   {
+      RingBufferBase< T, type > *q( 
+         reinterpret_cast< RingBufferBase< T, type >* >( context ) );
+      return( q->space_avail() > 0 || q->abandoned() );
+   }
+
+   bool await_ready()
+   {
+      return( ready( &queue ) );
+   }
+
+   void await_suspend( std::coroutine_handle<> handle )
+   {
+      Executor *executor( Executor::current() );
+      assert( executor != nullptr );
+      Buffer::Control &control( queue.control() );
+      executor->park( handle,
+                      PushAwaiter::ready,
+                      &queue,
+                      &control.space_epoch,
+                      &control.space_waiters,
+                      &control.watched );
+   }
+
+   bool await_resume()
+   {
+      return( queue.push( item, signal ) );
+   }
+};
+
+/**
+ * async_pop - co_await async_pop( queue, item ) pops the next
+ * item without parking the thread, false once the queue is
+ * drained.  item must stay alive until the co_await completes.
+ * @param queue  - RingBufferBase&
+ * @param item   - T&, untouched on false
+ * @param signal - RBSignal*, optional, set to the item's signal,
+ *                 or on false the out of band signal or RBEOF
+ */
+template < class T, RingBufferType type >
+PopAwaiter< T, type > async_pop( RingBufferBase< T, type > &queue,
+                                 T &item,
+                                 RBSignal *signal = nullptr )
+{
+   return( PopAwaiter< T, type >{ queue, item, signal } );
+}
+
+/**
+ * async_push - co_await async_push( queue, item ) pushes item
+ * once there is space without parking the thread.  item must
+ * stay alive until the co_await completes.
+ * @param queue  - RingBufferBase&
+ * @param item   - T&
+ * @param signal - const RBSignal, default: NONE
+ */
+template < class T, RingBufferType type >
+PushAwaiter< T, type > async_push( RingBufferBase< T, type > &queue,
+                                   T &item,
+                                   const RBSignal signal = RBSignal::NONE )
+{
+   return( PushAwaiter< T, type >{ queue, item, signal } );
+}
+#endif /* END _COROUTINES_TCC_ */
@@ -5,138 +5,7 @@
  * for x86, will add ARM soon.
  */
 
-//TODO, comment all below code
-
-typedef struct {
-     uint32_t
-         CF      :  1,
-                 :  1,
-         PF      :  1,
-                 :  1,
-         AF      :  1,
-                 :  1,
-         ZF      :  1,
-         SF      :  1,
-         TF      :  1,
-         IF      :  1,
-         DF      :  1,
-         OF      :  1,
-         IOPL    :  2,
-         NT      :  1,
-                 :  1,
-         RF      :  1,
-         VM      :  1,
-         AC      :  1,
-         VIF     :  1,
-         VIP     :  1,
-         ID      :  1,
-                 : 10;
-} EFlags;
-
-
-typedef struct {
-   uint32_t eax, ebx, ecx, edx;
-} Reg;
-
-enum feature_levels {
-	FL_NONE,
-	FL_MMX,
-	FL_SSE2,
-	FL_AVX
-};
-
-
-#define    CPUID_BASIC     0x0
-#define    CPUID_LEVEL1    0x1
-
-void zero_registers (Reg *in)
-{
-	in->eax = 0x0;
-	in->ebx = 0x0;
-	in->ecx = 0x0;
-	in->edx = 0x0;
-}
-
-
-/**
- * get_cpuid - sets eax, ebx, ecx, edx values in struct Reg based on input_eax input
- */
-void get_cpuid (Reg *input_registers, Reg *output_registers)
-{
-#if( __i386__ == 1 || __x86_64 == 1 )
-   __asm__ volatile ("\
-      movl  %[input_eax], %%eax     \n\
-      movl  %[input_ecx], %%ecx     \n\
-      cpuid                         \n\
-      movl  %%eax,        %[eax]    \n\
-      movl  %%ebx,        %[ebx]    \n\
-      movl  %%ecx,        %[ecx]    \n\
-      movl  %%edx,        %[edx]"
-      :
-      [eax] "=r"  (output_registers->eax),
-      [ebx] "=r"  (output_registers->ebx),
-      [ecx] "=r"  (output_registers->ecx),
-      [edx] "=r"  (output_registers->edx)
-      :
-      [input_eax] "m" (input_registers->eax),
-      [input_ecx] "m" (input_registers->ecx)
-      :
-      "eax","ebx","ecx","edx"
-      );
-#endif
-}
-
-int get_level0_data (unsigned int *max_level)
-{
-	Reg in, out;
-
-	in.eax = CPUID_BASIC;
-	get_cpuid(&in, &out);
-	
-	if (max_level)
-		*max_level = out.eax;
-		
-	return 0;
-}
-
-
-int get_level1_data (unsigned int max_level, unsigned int *eax, 
-	unsigned int *ecx, unsigned int *edx)
-{
-	Reg in, out;
-
-	in.eax = CPUID_LEVEL1;
-	get_cpuid(&in, &out);
-	
-	if (eax) *eax = out.eax;
-	if (ecx) *ecx = out.ecx;
-	if (edx) *edx = out.edx;
-	
-	return 0;
-}
-
-enum feature_levels get_highest_feature (unsigned int max_level)
-{
-	unsigned int ecx, edx;
-
-	if (max_level < 1) {
-		fprintf(stderr, "Error calling cpuid, cpuid not supported\n");
-		exit(-1);
-	}
-	
-	get_level1_data(max_level, NULL, &ecx, &edx);
-
-	if (ecx & (1 << 28))
-		return FL_AVX;
-
-	if (edx & (1 << 26))
-		return FL_SSE2;
-		
-	if (edx & (1 << 23))
-		return FL_MMX;
-			
-	return FL_NONE;
-}
+#include "x86cpuid.h"
 
       /*  	loop128%=:				\n\
 			vmovdqu (%%rax), %%ymm0		\n\
@@ -0,0 +1,177 @@
+/**
+ * futex.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 11:20:54 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <thread>
+#include <chrono>
+#include "futex.hpp"
+
+#if __linux
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+/** older headers don't know about the vectored wait **/
+#ifndef SYS_futex_waitv
+#define SYS_futex_waitv 449
+#endif
+#ifndef FUTEX_32
+#define FUTEX_32 2
+#endif
+
+/** same layout as the kernel's struct futex_waitv **/
+struct WaitV
+{
+   std::uint64_t val;
+   std::uint64_t uaddr;
+   std::uint32_t flags;
+   std::uint32_t reserved;
+};
+#endif
+
+/** fallback slice when we can't sleep on all the words at once **/
+static const std::int64_t poll_slice_ns( 50000 );
+
+void
+Futex::wait( std::atomic< std::uint32_t > *word,
+             const std::uint32_t expected,
+             const std::int64_t timeout_ns )
+{
+#if __linux
+   struct timespec ts;
+   struct timespec *tsp( nullptr );
+   if( timeout_ns >= 0 )
+   {
+      ts.tv_sec  = timeout_ns / 1000000000;
+      ts.tv_nsec = timeout_ns % 1000000000;
+      tsp = &ts;
+   }
+   /** EAGAIN (value changed), EINTR and ETIMEDOUT are all fine **/
+   syscall( SYS_futex,
+            reinterpret_cast< std::uint32_t* >( word ),
+            FUTEX_WAIT,
+            expected,
+            tsp,
+            nullptr,
+            0 );
+#else
+   if( word->load( std::memory_order_acquire ) == expected )
+   {
+      std::this_thread::sleep_for( std::chrono::nanoseconds(
+         timeout_ns >= 0 && timeout_ns < poll_slice_ns ?
+            timeout_ns : poll_slice_ns ) );
+   }
+#endif
+}
+
+void
+Futex::wake( std::atomic< std::uint32_t > *word,
+             const int count )
+{
+#if __linux
+   syscall( SYS_futex,
+            reinterpret_cast< std::uint32_t* >( word ),
+            FUTEX_WAKE,
+            count,
+            nullptr,
+            nullptr,
+            0 );
+#else
+   (void) word;
+   (void) count;
+#endif
+}
+
+void
+Futex::waitAny( std::atomic< std::uint32_t > **words,
+                const std::uint32_t *expected,
+                const size_t n,
+                const std::int64_t timeout_ns )
+{
+   if( n == 0 )
+   {
+      return;
+   }
+   if( n == 1 )
+   {
+      Futex::wait( words[ 0 ], expected[ 0 ], timeout_ns );
+      return;
+   }
+#if __linux
+   /** -1 = untested, 0 = not supported, 1 = supported **/
+   static std::atomic< int > have_waitv( -1 );
+   if( n <= Futex::maxWaitAny() && have_waitv.load() != 0 )
+   {
+      WaitV waiters[ 128 ];
+      std::memset( waiters, 0, sizeof( WaitV ) * n );
+      for( size_t i( 0 ); i < n; i++ )
+      {
+         waiters[ i ].val   = expected[ i ];
+         waiters[ i ].uaddr = (std::uint64_t)(uintptr_t) words[ i ];
+         waiters[ i ].flags = FUTEX_32;
+      }
+      /** futex_waitv takes an absolute timeout **/
+      struct timespec ts;
+      struct timespec *tsp( nullptr );
+      if( timeout_ns >= 0 )
+      {
+         clock_gettime( CLOCK_MONOTONIC, &ts );
+         const std::int64_t nsec( ts.tv_nsec + timeout_ns );
+         ts.tv_sec  += nsec / 1000000000;
+         ts.tv_nsec  = nsec % 1000000000;
+         tsp = &ts;
+      }
+      errno = 0;
+      const long ret( syscall( SYS_futex_waitv,
+                               waiters,
+                               (unsigned int) n,
+                               0,
+                               tsp,
+                               CLOCK_MONOTONIC ) );
+      if( ret == -1 && errno == ENOSYS )
+      {
+         have_waitv.store( 0 );
+      }
+      else
+      {
+         have_waitv.store( 1 );
+         return;
+      }
+   }
+#endif
+   /** can't sleep on all of them, sleep a slice and let caller re-poll **/
+   for( size_t i( 0 ); i < n; i++ )
+   {
+      if( words[ i ]->load( std::memory_order_acquire ) != expected[ i ] )
+      {
+         return;
+      }
+   }
+   std::this_thread::sleep_for( std::chrono::nanoseconds(
+      timeout_ns >= 0 && timeout_ns < poll_slice_ns ?
+         timeout_ns : poll_slice_ns ) );
+}
+
+size_t
+Futex::maxWaitAny()
+{
+   return( 128 );
+}
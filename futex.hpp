@@ -0,0 +1,80 @@
+/**
+ * futex.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 11:20:54 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _FUTEX_HPP_
+#define _FUTEX_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * Futex - thin wrapper around the futex calls used to sleep on
+ * a 32 bit word until another thread or process bumps it.  The
+ * words may live in SHM so the shared (non-private) variants are
+ * used throughout.  On platforms without futexes every call
+ * degrades to a short sleep so callers must always re-check
+ * whatever condition they're waiting on.
+ */
+class Futex
+{
+public:
+   Futex()           = delete;
+   virtual ~Futex()  = delete;
+
+   /**
+    * wait - sleep while *word == expected, or until timeout_ns
+    * nanoseconds have passed.  Spurious returns are possible.
+    * @param word       - std::atomic< std::uint32_t >*
+    * @param expected   - const std::uint32_t
+    * @param timeout_ns - const std::int64_t, < 0 waits forever
+    */
+   static void wait( std::atomic< std::uint32_t > *word,
+                     const std::uint32_t expected,
+                     const std::int64_t timeout_ns = -1 );
+
+   /**
+    * wake - wake up to count sleepers on word.
+    * @param word  - std::atomic< std::uint32_t >*
+    * @param count - const int, default: all
+    */
+   static void wake( std::atomic< std::uint32_t > *word,
+                     const int count = INT32_MAX );
+
+   /**
+    * waitAny - sleep until any of the n words differs from its
+    * expected value or timeout_ns passes.  Uses futex_waitv where
+    * the kernel has it (Linux 5.16+), otherwise sleeps for a
+    * short slice and returns so the caller re-polls.
+    * @param words      - std::atomic< std::uint32_t >**, n entries
+    * @param expected   - const std::uint32_t*, n entries
+    * @param n          - const size_t, at most maxWaitAny()
+    * @param timeout_ns - const std::int64_t, < 0 waits forever
+    */
+   static void waitAny( std::atomic< std::uint32_t > **words,
+                        const std::uint32_t *expected,
+                        const size_t n,
+                        const std::int64_t timeout_ns = -1 );
+
+   /**
+    * maxWaitAny - largest n that waitAny can sleep on at once.
+    * @return size_t
+    */
+   static size_t maxWaitAny();
+};
+#endif /* END _FUTEX_HPP_ */
@@ -0,0 +1,166 @@
+/**
+ * histogram.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 16:21:37 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cmath>
+#include "histogram.hpp"
+
+Histogram::Histogram()
+{
+   reset();
+}
+
+void
+Histogram::record( const std::uint64_t value )
+{
+   counts[ index( value ) ].fetch_add( 1, std::memory_order_relaxed );
+   total.fetch_add( 1, std::memory_order_relaxed );
+   sum.fetch_add( value, std::memory_order_relaxed );
+   std::uint64_t current( maximum.load( std::memory_order_relaxed ) );
+   while( value > current &&
+          ! maximum.compare_exchange_weak( current, value,
+                                           std::memory_order_relaxed ) );
+}
+
+void
+Histogram::merge( const Histogram &other )
+{
+   for( std::uint32_t i( 0 ); i < bucket_count; i++ )
+   {
+      const std::uint64_t n( other.counts[ i ].load( std::memory_order_relaxed ) );
+      if( n != 0 )
+      {
+         counts[ i ].fetch_add( n, std::memory_order_relaxed );
+      }
+   }
+   total.fetch_add( other.total.load( std::memory_order_relaxed ),
+                    std::memory_order_relaxed );
+   sum.fetch_add( other.sum.load( std::memory_order_relaxed ),
+                  std::memory_order_relaxed );
+   const std::uint64_t value( other.maximum.load( std::memory_order_relaxed ) );
+   std::uint64_t current( maximum.load( std::memory_order_relaxed ) );
+   while( value > current &&
+          ! maximum.compare_exchange_weak( current, value,
+                                           std::memory_order_relaxed ) );
+}
+
+void
+Histogram::reset()
+{
+   for( std::uint32_t i( 0 ); i < bucket_count; i++ )
+   {
+      counts[ i ].store( 0, std::memory_order_relaxed );
+   }
+   total.store( 0, std::memory_order_relaxed );
+   sum.store( 0, std::memory_order_relaxed );
+   maximum.store( 0, std::memory_order_relaxed );
+}
+
+std::uint64_t
+Histogram::percentile( const double p ) const
+{
+   /** sum the buckets rather than trust total, they can race **/
+   std::uint64_t n( 0 );
+   for( std::uint32_t i( 0 ); i < bucket_count; i++ )
+   {
+      n += counts[ i ].load( std::memory_order_relaxed );
+   }
+   if( n == 0 )
+   {
+      return( 0 );
+   }
+   std::uint64_t target( (std::uint64_t) std::ceil( ( p / 100.0 ) * n ) );
+   if( target == 0 )
+   {
+      target = 1;
+   }
+   const std::uint64_t largest( max() );
+   std::uint64_t seen( 0 );
+   for( std::uint32_t i( 0 ); i < bucket_count; i++ )
+   {
+      seen += counts[ i ].load( std::memory_order_relaxed );
+      if( seen >= target )
+      {
+         const std::uint64_t bound( upper( i ) );
+         return( bound < largest ? bound : largest );
+      }
+   }
+   return( largest );
+}
+
+std::uint64_t
+Histogram::count() const
+{
+   return( total.load( std::memory_order_relaxed ) );
+}
+
+std::uint64_t
+Histogram::max() const
+{
+   return( maximum.load( std::memory_order_relaxed ) );
+}
+
+double
+Histogram::mean() const
+{
+   const std::uint64_t n( count() );
+   if( n == 0 )
+   {
+      return( 0.0 );
+   }
+   return( (double) sum.load( std::memory_order_relaxed ) / (double) n );
+}
+
+std::ostream&
+Histogram::print( std::ostream &stream ) const
+{
+   stream << "count: " << count() <<
+             ", p50: "   << percentile( 50.0 ) <<
+             ", p99: "   << percentile( 99.0 ) <<
+             ", p99.9: " << percentile( 99.9 ) <<
+             ", max: "   << max() <<
+             ", mean: "  << mean();
+   return( stream );
+}
+
+std::uint32_t
+Histogram::index( const std::uint64_t value )
+{
+   if( value < sub_count )
+   {
+      return( (std::uint32_t) value );
+   }
+   const std::uint32_t msb( 63 - __builtin_clzll( value ) );
+   const std::uint32_t shift( msb - ( sub_bits - 1 ) );
+   const std::uint32_t top( (std::uint32_t) ( value >> shift ) );
+   return( sub_count + ( ( shift - 1 ) * half_count ) + ( top - half_count ) );
+}
+
+std::uint64_t
+Histogram::upper( const std::uint32_t i )
+{
+   if( i < sub_count )
+   {
+      return( i );
+   }
+   const std::uint32_t j( i - sub_count );
+   const std::uint32_t shift( ( j / half_count ) + 1 );
+   const std::uint64_t top( ( j % half_count ) + half_count );
+   /** wraps to UINT64_MAX for the very last bucket **/
+   return( ( ( top + 1 ) << shift ) - 1 );
+}
@@ -0,0 +1,96 @@
+/**
+ * histogram.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 16:21:37 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _HISTOGRAM_HPP_
+#define _HISTOGRAM_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <ostream>
+
+/**
+ * Histogram - log-linear (HDR style) histogram of 64 bit values,
+ * typically nanoseconds.  Values below 2^sub_bits are counted
+ * exactly, above that each power of two is split into
+ * 2^(sub_bits-1) linear buckets so any recorded value is within
+ * 1/64th of its bucket's bounds.  Fixed size, recording is a
+ * single relaxed fetch_add so any number of threads can record
+ * at once, and all-zero memory is a valid empty histogram so it
+ * can sit in a SHM segment.
+ */
+class Histogram
+{
+public:
+   static const std::uint32_t sub_bits = 7;
+   static const std::uint32_t sub_count = ( 1 << sub_bits );
+   static const std::uint32_t half_count = ( sub_count >> 1 );
+   static const std::uint32_t bucket_count =
+      sub_count + ( ( 64 - sub_bits ) * half_count );
+
+   Histogram();
+
+   /**
+    * record - count one value, lock-free.
+    * @param value - const std::uint64_t
+    */
+   void record( const std::uint64_t value );
+
+   /**
+    * merge - add every count of other into this one, other may
+    * still be recording while this runs.
+    * @param other - const Histogram&
+    */
+   void merge( const Histogram &other );
+
+   /**
+    * reset - zero every count, not safe against concurrent
+    * record() calls.
+    */
+   void reset();
+
+   /**
+    * percentile - smallest bucket value at or above the given
+    * fraction of recorded values.
+    * @param p - const double, 0.0 - 100.0
+    * @return std::uint64_t, zero if empty
+    */
+   std::uint64_t percentile( const double p ) const;
+
+   std::uint64_t count() const;
+   std::uint64_t max() const;
+   double        mean() const;
+
+   /**
+    * print - one line, count p50 p99 p99.9 max and mean
+    * @param stream - std::ostream&
+    * @return std::ostream&
+    */
+   std::ostream& print( std::ostream &stream ) const;
+
+private:
+   static std::uint32_t index( const std::uint64_t value );
+   /** upper bound of the values counted in bucket i **/
+   static std::uint64_t upper( const std::uint32_t i );
+
+   std::atomic< std::uint64_t > counts[ bucket_count ];
+   std::atomic< std::uint64_t > total;
+   std::atomic< std::uint64_t > sum;
+   std::atomic< std::uint64_t > maximum;
+};
+#endif /* END _HISTOGRAM_HPP_ */
@@ -0,0 +1,671 @@
+/**
+ * lossyringbuffer.tcc -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 09:40:12 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Notes: the two queues in here never block the producer.  The
+ * OverwriteRingBuffer drops the oldest entries when the consumer
+ * falls more than a capacity behind, the ConflatingRingBuffer keeps
+ * at most one pending entry per key and coalesces updates in place.
+ * Both copy items while the producer may be writing them so the
+ * item (and key) types must be trivially copyable.  The producer
+ * ends the stream with close(), the blocking pop() then returns
+ * false once the consumer has read what is left.
+ */
+#ifndef _LOSSYRINGBUFFER_TCC_
+#define _LOSSYRINGBUFFER_TCC_  1
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <cassert>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unordered_map>
+#include <type_traits>
+#include "ringbuffertypes.hpp"
+#include "signalvars.hpp"
+#include "region.tcc"
+#include "spinwait.hpp"
+
+/**
+ * OverwriteRingBuffer - single producer, single consumer ring
+ * where push() always succeeds.  Every slot carries the sequence
+ * number of the item in it (stamped odd while being written, even
+ * once complete) so the consumer can tell when it has been lapped,
+ * skip ahead to the oldest item still in the ring and count how
+ * many it missed.
+ * @templateparam T - trivially copyable type for queue to contain
+ * @templateparam type - Heap or SharedMemory
+ */
+template < class T,
+           RingBufferType type = RingBufferType::Heap >
+class OverwriteRingBuffer
+{
+   static_assert( std::is_trivially_copyable< T >::value,
+                  "OverwriteRingBuffer requires a trivially copyable type" );
+public:
+   /**
+    * OverwriteRingBuffer - heap allocated version.
+    * @param n - const size_t, number of slots
+    */
+   OverwriteRingBuffer( const size_t n ) : max_cap( n ),
+                                           region( nullptr ),
+                                           read_seq( 0 ),
+                                           write_seq( 0 ),
+                                           overrun_count( 0 )
+   {
+      assert( n > 0 );
+      region = new Buffer::Region< type >( length( n ) );
+      init( Direction::Producer );
+   }
+
+   /**
+    * OverwriteRingBuffer - SHM version, the producer side creates
+    * and initializes the segment, the consumer waits for it.
+    * @param n   - const size_t, number of slots, same on both sides
+    * @param key - const std::string, SHM key
+    * @param dir - Direction
+    */
+   OverwriteRingBuffer( const size_t      n,
+                        const std::string key,
+                        Direction         dir ) : max_cap( n ),
+                                                  region( nullptr ),
+                                                  read_seq( 0 ),
+                                                  write_seq( 0 ),
+                                                  overrun_count( 0 )
+   {
+      assert( n > 0 );
+      region = new Buffer::Region< type >( length( n ), key, dir );
+      init( dir );
+   }
+
+   virtual ~OverwriteRingBuffer()
+   {
+      delete( region );
+      region = nullptr;
+   }
+
+   /**
+    * allocate - reference to the next slot, the slot is marked
+    * as being written so a consumer that has been lapped won't
+    * read a partial item.  Release with push( signal ).
+    * @return T&
+    */
+   T& allocate()
+   {
+      Slot &slot( slots[ write_seq % max_cap ] );
+      slot.seq.store( writing( write_seq ), std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      return( slot.item );
+   }
+
+   /**
+    * push - publish the slot handed out by allocate().  Pushing
+    * RBEOF also close()s the queue.
+    * @param signal - const RBSignal, default: NONE
+    */
+   void push( const RBSignal signal = RBSignal::NONE )
+   {
+      Slot &slot( slots[ write_seq % max_cap ] );
+      slot.sig = signal;
+      publish( slot );
+      if( signal == RBSignal::RBEOF )
+      {
+         close();
+      }
+   }
+
+   /**
+    * push - copy item into the ring, never blocks, overwrites
+    * the oldest item if the consumer hasn't gotten to it yet.
+    * @param item   - const T&
+    * @param signal - const RBSignal, default: NONE
+    */
+   void push( const T &item, const RBSignal signal = RBSignal::NONE )
+   {
+      Slot &slot( slots[ write_seq % max_cap ] );
+      slot.seq.store( writing( write_seq ), std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      slot.item = item;
+      slot.sig  = signal;
+      publish( slot );
+      if( signal == RBSignal::RBEOF )
+      {
+         close();
+      }
+   }
+
+   /**
+    * try_pop - read the oldest item still in the ring.  If the
+    * producer has lapped the consumer the missed items are added
+    * to overruns() and reading resumes at the oldest valid item.
+    * @param item   - T&, set if return is true
+    * @param signal - RBSignal*, optional
+    * @return bool  - false if the ring is empty
+    */
+   bool try_pop( T &item, RBSignal *signal = nullptr )
+   {
+      while( true )
+      {
+         const std::uint64_t head(
+            control->write_seq.load( std::memory_order_acquire ) );
+         if( head == read_seq )
+         {
+            return( false );
+         }
+         if( head - read_seq > max_cap )
+         {
+            overrun_count += ( head - max_cap ) - read_seq;
+            read_seq = head - max_cap;
+         }
+         Slot &slot( slots[ read_seq % max_cap ] );
+         const std::uint64_t before(
+            slot.seq.load( std::memory_order_acquire ) );
+         if( before != written( read_seq ) )
+         {
+            /** lapped while we were looking, re-read head **/
+            relax();
+            continue;
+         }
+         const T        copy( slot.item );
+         const RBSignal sig( slot.sig );
+         std::atomic_thread_fence( std::memory_order_acquire );
+         if( slot.seq.load( std::memory_order_relaxed ) != before )
+         {
+            continue;
+         }
+         item = copy;
+         if( signal != nullptr )
+         {
+            *signal = sig;
+         }
+         read_seq++;
+         return( true );
+      }
+   }
+
+   /**
+    * pop - blocking version of try_pop, waits for data or for
+    * the producer to close().
+    * @param item   - T&, untouched on false
+    * @param signal - RBSignal*, optional
+    * @return bool  - false once the queue is drained
+    */
+   bool pop( T &item, RBSignal *signal = nullptr )
+   {
+      while( ! try_pop( item, signal ) )
+      {
+         if( closed() )
+         {
+            /** nothing more is coming, recheck now the last write is in **/
+            return( try_pop( item, signal ) );
+         }
+         relax();
+      }
+      return( true );
+   }
+
+   /**
+    * close - producer's end of stream, the consumer reads what
+    * is left and pop() then returns false.
+    */
+   void close()
+   {
+      control->closed.store( 1, std::memory_order_release );
+   }
+
+   /**
+    * closed - true once the producer has closed, there may still
+    * be items to pop.
+    * @return bool
+    */
+   bool closed() const
+   {
+      return( control->closed.load( std::memory_order_acquire ) != 0 );
+   }
+
+   /**
+    * drained - closed and nothing left to pop, what pop()
+    * returning false means.
+    * @return bool
+    */
+   bool drained()
+   {
+      /** closed first, close() comes after the last publish **/
+      return( closed() && size() == 0 );
+   }
+
+   /**
+    * size - number of items the consumer could still read,
+    * never more than capacity().
+    * @return size_t
+    */
+   size_t size()
+   {
+      const std::uint64_t head(
+         control->write_seq.load( std::memory_order_acquire ) );
+      const std::uint64_t diff( head - read_seq );
+      return( diff > max_cap ? max_cap : (size_t) diff );
+   }
+
+   size_t capacity() const
+   {
+      return( max_cap );
+   }
+
+   /**
+    * overruns - total number of items this consumer never saw
+    * because the producer overwrote them.
+    * @return std::uint64_t
+    */
+   std::uint64_t overruns() const
+   {
+      return( overrun_count );
+   }
+
+private:
+   struct Slot
+   {
+      std::atomic< std::uint64_t > seq;
+      T                            item;
+      RBSignal                     sig;
+   };
+
+   struct Control
+   {
+      alignas( 64 ) std::atomic< std::uint64_t > write_seq;
+      alignas( 64 ) std::atomic< std::uint32_t > ready;
+      std::atomic< std::uint32_t >               closed;
+   };
+
+   static constexpr std::uint32_t ready_magic = 0x1337;
+
+   static size_t length( const size_t n )
+   {
+      return( sizeof( Control ) + ( sizeof( Slot ) * n ) );
+   }
+
+   /** slot stamps, zero means never written **/
+   static std::uint64_t writing( const std::uint64_t seq )
+   {
+      return( ( seq << 1 ) + 1 );
+   }
+
+   static std::uint64_t written( const std::uint64_t seq )
+   {
+      return( ( seq << 1 ) + 2 );
+   }
+
+   static void relax()
+   {
+      spin_relax();
+   }
+
+   void init( Direction dir )
+   {
+      control = reinterpret_cast< Control* >( region->ptr );
+      slots   = reinterpret_cast< Slot* >(
+         reinterpret_cast< char* >( region->ptr ) + sizeof( Control ) );
+      if( dir == Direction::Producer )
+      {
+         /** memory is zeroed, zero stamps are never valid **/
+         control->write_seq.store( 0, std::memory_order_relaxed );
+         control->ready.store( ready_magic, std::memory_order_release );
+      }
+      else
+      {
+         while( control->ready.load( std::memory_order_acquire ) !=
+                  ready_magic )
+         {
+            std::this_thread::yield();
+         }
+         /** late attaching consumers start at the oldest item **/
+         const std::uint64_t head(
+            control->write_seq.load( std::memory_order_acquire ) );
+         read_seq = ( head > max_cap ? head - max_cap : 0 );
+      }
+   }
+
+   void publish( Slot &slot )
+   {
+      slot.seq.store( written( write_seq ), std::memory_order_release );
+      write_seq++;
+      control->write_seq.store( write_seq, std::memory_order_release );
+   }
+
+   const size_t                 max_cap;
+   Buffer::Region< type >      *region;
+   Control                     *control;
+   Slot                        *slots;
+   /** endpoint local, each side only touches its own **/
+   std::uint64_t                read_seq;
+   std::uint64_t                write_seq;
+   std::uint64_t                overrun_count;
+};
+
+
+/**
+ * ConflatingRingBuffer - single producer, single consumer queue
+ * of (key, value) pairs with at most one pending entry per key.
+ * Pushing a key that is still waiting to be read replaces its
+ * value in place rather than adding another entry, so the queue
+ * can never fill up.  Each key gets a slot the first time it is
+ * seen, up to max_keys distinct keys.  Keys are looked up on the
+ * producer side only, so K needs a std::hash specialization.
+ * @templateparam K - trivially copyable key type
+ * @templateparam T - trivially copyable value type
+ * @templateparam type - Heap or SharedMemory
+ */
+template < class K,
+           class T,
+           RingBufferType type = RingBufferType::Heap >
+class ConflatingRingBuffer
+{
+   static_assert( std::is_trivially_copyable< K >::value &&
+                  std::is_trivially_copyable< T >::value,
+                  "ConflatingRingBuffer requires trivially copyable types" );
+public:
+   /**
+    * ConflatingRingBuffer - heap allocated version.
+    * @param max_keys - const size_t, max distinct keys
+    */
+   ConflatingRingBuffer( const size_t max_keys ) : max_keys( max_keys ),
+                                                   region( nullptr ),
+                                                   used( 0 ),
+                                                   head( 0 ),
+                                                   tail( 0 ),
+                                                   coalesce_count( 0 ),
+                                                   delivered( max_keys, 0 )
+   {
+      assert( max_keys > 0 );
+      region = new Buffer::Region< type >( length( max_keys ) );
+      init( Direction::Producer );
+   }
+
+   /**
+    * ConflatingRingBuffer - SHM version.
+    * @param max_keys - const size_t, same on both sides
+    * @param key      - const std::string, SHM key
+    * @param dir      - Direction
+    */
+   ConflatingRingBuffer( const size_t      max_keys,
+                         const std::string key,
+                         Direction         dir ) : max_keys( max_keys ),
+                                                   region( nullptr ),
+                                                   used( 0 ),
+                                                   head( 0 ),
+                                                   tail( 0 ),
+                                                   coalesce_count( 0 ),
+                                                   delivered( max_keys, 0 )
+   {
+      assert( max_keys > 0 );
+      region = new Buffer::Region< type >( length( max_keys ), key, dir );
+      init( dir );
+   }
+
+   virtual ~ConflatingRingBuffer()
+   {
+      delete( region );
+      region = nullptr;
+   }
+
+   /**
+    * push - set the latest value for key, never blocks.  If the
+    * key already has an entry waiting the value is replaced in
+    * place, otherwise a new entry is queued.
+    * @param key  - const K&
+    * @param item - const T&
+    * @return bool - false only if key is new and max_keys distinct
+    *                keys have already been seen.
+    */
+   bool push( const K &key, const T &item )
+   {
+      size_t index( 0 );
+      const auto found( slot_of.find( key ) );
+      if( found == slot_of.end() )
+      {
+         if( used == max_keys )
+         {
+            return( false );
+         }
+         index = used++;
+         slot_of.insert( std::make_pair( key, index ) );
+      }
+      else
+      {
+         index = (*found).second;
+      }
+      Entry &entry( entries[ index ] );
+      const std::uint64_t version(
+         entry.seq.load( std::memory_order_relaxed ) );
+      entry.seq.store( version + 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      entry.key  = key;
+      entry.item = item;
+      entry.seq.store( version + 2, std::memory_order_release );
+      /**
+       * full barrier here orders the value write before the
+       * pending check against the consumer clearing it.
+       */
+      if( entry.pending.exchange( 1, std::memory_order_seq_cst ) == 0 )
+      {
+         ring[ head % max_keys ] = (std::uint32_t) index;
+         head++;
+         control->head.store( head, std::memory_order_release );
+      }
+      else
+      {
+         coalesce_count++;
+      }
+      return( true );
+   }
+
+   /**
+    * try_pop - read the oldest pending key and its latest value.
+    * @param key  - K&
+    * @param item - T&
+    * @return bool - false if nothing is pending
+    */
+   bool try_pop( K &key, T &item )
+   {
+      while( true )
+      {
+         if( control->head.load( std::memory_order_acquire ) == tail )
+         {
+            return( false );
+         }
+         const std::uint32_t index( ring[ tail % max_keys ] );
+         tail++;
+         control->tail.store( tail, std::memory_order_release );
+         Entry &entry( entries[ index ] );
+         /** clear before reading so later updates get queued again **/
+         entry.pending.exchange( 0, std::memory_order_seq_cst );
+         std::uint64_t before( 0 );
+         while( true )
+         {
+            before = entry.seq.load( std::memory_order_acquire );
+            if( before & 1 )
+            {
+               /** producer mid write, never blocks so wait it out **/
+               spin_pause();
+               continue;
+            }
+            const K key_copy( entry.key );
+            const T item_copy( entry.item );
+            std::atomic_thread_fence( std::memory_order_acquire );
+            if( entry.seq.load( std::memory_order_relaxed ) == before )
+            {
+               key  = key_copy;
+               item = item_copy;
+               break;
+            }
+         }
+         /**
+          * an update landing between clearing pending and the read
+          * above gets queued again, skip it if we've already got it.
+          */
+         if( delivered[ index ] == before )
+         {
+            continue;
+         }
+         delivered[ index ] = before;
+         return( true );
+      }
+   }
+
+   /**
+    * pop - blocking version of try_pop, waits for an update or
+    * for the producer to close().
+    * @param key  - K&, untouched on false
+    * @param item - T&, untouched on false
+    * @return bool - false once the queue is drained
+    */
+   bool pop( K &key, T &item )
+   {
+      while( ! try_pop( key, item ) )
+      {
+         if( closed() )
+         {
+            /** nothing more is coming, recheck now the last write is in **/
+            return( try_pop( key, item ) );
+         }
+         spin_relax();
+      }
+      return( true );
+   }
+
+   /**
+    * close - producer's end of stream, the consumer reads the
+    * updates still pending and pop() then returns false.
+    */
+   void close()
+   {
+      control->closed.store( 1, std::memory_order_release );
+   }
+
+   /**
+    * closed - true once the producer has closed, there may still
+    * be updates to pop.
+    * @return bool
+    */
+   bool closed() const
+   {
+      return( control->closed.load( std::memory_order_acquire ) != 0 );
+   }
+
+   /**
+    * drained - closed and nothing left to pop, what pop()
+    * returning false means.
+    * @return bool
+    */
+   bool drained()
+   {
+      return( closed() && size() == 0 );
+   }
+
+   /**
+    * size - number of keys with a pending update.
+    * @return size_t
+    */
+   size_t size()
+   {
+      return( control->head.load( std::memory_order_acquire ) -
+              control->tail.load( std::memory_order_acquire ) );
+   }
+
+   size_t capacity() const
+   {
+      return( max_keys );
+   }
+
+   /**
+    * coalesced - number of pushes (producer side) that replaced
+    * a pending value instead of queueing a new entry.
+    * @return std::uint64_t
+    */
+   std::uint64_t coalesced() const
+   {
+      return( coalesce_count );
+   }
+
+private:
+   struct Entry
+   {
+      std::atomic< std::uint64_t > seq;
+      std::atomic< std::uint32_t > pending;
+      K                            key;
+      T                            item;
+   };
+
+   struct Control
+   {
+      alignas( 64 ) std::atomic< std::uint64_t > head;
+      alignas( 64 ) std::atomic< std::uint64_t > tail;
+      alignas( 64 ) std::atomic< std::uint32_t > ready;
+      std::atomic< std::uint32_t >               closed;
+   };
+
+   static constexpr std::uint32_t ready_magic = 0x1337;
+
+   static size_t length( const size_t n )
+   {
+      return( sizeof( Control ) +
+              ( sizeof( Entry ) * n ) +
+              ( sizeof( std::uint32_t ) * n ) );
+   }
+
+   void init( Direction dir )
+   {
+      char *base( reinterpret_cast< char* >( region->ptr ) );
+      control = reinterpret_cast< Control* >( base );
+      entries = reinterpret_cast< Entry* >( base + sizeof( Control ) );
+      ring    = reinterpret_cast< std::uint32_t* >(
+         base + sizeof( Control ) + ( sizeof( Entry ) * max_keys ) );
+      if( dir == Direction::Producer )
+      {
+         control->ready.store( ready_magic, std::memory_order_release );
+      }
+      else
+      {
+         while( control->ready.load( std::memory_order_acquire ) !=
+                  ready_magic )
+         {
+            std::this_thread::yield();
+         }
+         tail = control->tail.load( std::memory_order_acquire );
+      }
+   }
+
+   const size_t                      max_keys;
+   Buffer::Region< type >           *region;
+   Control                          *control;
+   Entry                            *entries;
+   std::uint32_t                    *ring;
+   /** producer local **/
+   std::unordered_map< K, size_t >   slot_of;
+   size_t                            used;
+   std::uint64_t                     head;
+   /** consumer local **/
+   std::uint64_t                     tail;
+   /** producer local **/
+   std::uint64_t                     coalesce_count;
+   /** consumer local, last version read from each entry **/
+   std::vector< std::uint64_t >      delivered;
+};
+#endif /* END _LOSSYRINGBUFFER_TCC_ */
@@ -0,0 +1,162 @@
+/**
+ * mailbox.tcc -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 10:48:22 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Notes: a Mailbox only ever holds the latest value, it is meant
+ * for state that readers poll (config snapshots, top of book) where
+ * sending every update through a FIFO would just be skipped over.
+ */
+#ifndef _MAILBOX_TCC_
+#define _MAILBOX_TCC_  1
+#include <atomic>
+#include <cstdint>
+#include <cassert>
+#include <string>
+#include <thread>
+#include "ringbuffertypes.hpp"
+#include "region.tcc"
+#include "seqlock.tcc"
+
+/**
+ * Mailbox - single writer, many reader "latest value" channel.
+ * For SharedMemory the Producer side creates the segment and is
+ * the writer, any number of Consumer side objects may attach.
+ * @templateparam T - trivially copyable type
+ * @templateparam type - Heap or SharedMemory
+ */
+template < class T,
+           RingBufferType type = RingBufferType::Heap >
+class Mailbox
+{
+public:
+   /**
+    * Mailbox - heap allocated version, share the object between
+    * the writing thread and the reading threads.
+    */
+   Mailbox() : region( nullptr ),
+               control( nullptr )
+   {
+      region = new Buffer::Region< type >( sizeof( Control ) );
+      init( Direction::Producer );
+   }
+
+   /**
+    * Mailbox - SHM version.
+    * @param key - const std::string, SHM key
+    * @param dir - Direction, Producer writes, Consumer reads
+    */
+   Mailbox( const std::string key,
+            Direction         dir ) : region( nullptr ),
+                                      control( nullptr )
+   {
+      region = new Buffer::Region< type >( sizeof( Control ), key, dir );
+      init( dir );
+   }
+
+   virtual ~Mailbox()
+   {
+      delete( region );
+      region = nullptr;
+   }
+
+   /**
+    * write - replace the current value, never blocks.
+    * @param val - const T&
+    */
+   void write( const T &val )
+   {
+      control->cell.write( val );
+   }
+
+   /**
+    * read - copy out the latest value.
+    * @param out   - T&
+    * @return bool - false if nothing has been written yet
+    */
+   bool read( T &out )
+   {
+      std::uint64_t version( 0 );
+      out = control->cell.read( &version );
+      return( version != 0 );
+   }
+
+   /**
+    * read_if_newer - copy out the latest value only if it was
+    * written after the one the caller last saw.
+    * @param out  - T&
+    * @param last - std::uint64_t&, version last seen, start at 0
+    *               and it is updated when the return is true
+    * @return bool - true if out was set to a newer value
+    */
+   bool read_if_newer( T &out, std::uint64_t &last )
+   {
+      if( control->cell.version() == last )
+      {
+         return( false );
+      }
+      std::uint64_t version( 0 );
+      const T copy( control->cell.read( &version ) );
+      if( version == last )
+      {
+         return( false );
+      }
+      out  = copy;
+      last = version;
+      return( true );
+   }
+
+   /**
+    * version - zero until the first write, increases with each
+    * write after that.
+    * @return std::uint64_t
+    */
+   std::uint64_t version()
+   {
+      return( control->cell.version() );
+   }
+
+private:
+   struct Control
+   {
+      alignas( 64 ) SeqLock< T >                  cell;
+      alignas( 64 ) std::atomic< std::uint32_t >  ready;
+   };
+
+   static constexpr std::uint32_t ready_magic = 0x1337;
+
+   void init( Direction dir )
+   {
+      control = reinterpret_cast< Control* >( region->ptr );
+      if( dir == Direction::Producer )
+      {
+         control->ready.store( ready_magic, std::memory_order_release );
+      }
+      else
+      {
+         while( control->ready.load( std::memory_order_acquire ) !=
+                  ready_magic )
+         {
+            std::this_thread::yield();
+         }
+      }
+   }
+
+   Buffer::Region< type >  *region;
+   Control                 *control;
+};
+#endif /* END _MAILBOX_TCC_ */
@@ -16,6 +16,7 @@
 #include "SystemClock.tcc"
 #include "randomstring.tcc"
 #include "signalvars.hpp"
+#include "histogram.hpp"
 
 #define MAX_VAL 100000000
 
@@ -36,6 +37,27 @@ struct Data
 //#define USESharedMemory 1
 #define USELOCAL 1
 #define BUFFSIZE 100
+//#define TRACELATENCY 1
+/** sample one item in TRACEEVERY for push to pop latency **/
+#define TRACEEVERY 64
+
+#if TRACELATENCY
+Histogram latency;
+#endif
+
+#ifdef RB_WAIT_STATS
+/** one line per end, build with -DRB_WAIT_STATS in CXXFLAGS **/
+static std::ostream&
+print_waits( std::ostream &stream, const char *name, const WaitCounts &counts )
+{
+   stream << name << " waits: " << counts.waits <<
+             ", spins: "        << counts.spins <<
+             ", yields: "       << counts.yields <<
+             ", sleeps: "       << counts.sleeps <<
+             ", blocked: "      << ( counts.blocked_ns * 1.0e-9 ) << "s\n";
+   return( stream );
+}
+#endif
 
 #ifdef USESharedMemory
 typedef RingBuffer< std::int64_t, 
@@ -48,7 +70,12 @@ typedef RingBuffer< std::int64_t          /* buffer type */,
 #endif
 
 
-Clock *system_clock = new SystemClock< System >( 1 );
+#ifdef USESharedMemory
+/** set in test(), both processes read the same shared clock **/
+Clock *system_clock = nullptr;
+#else
+Clock *system_clock = new SystemClock< TSC >( 1 );
+#endif
 
 
 void
@@ -81,10 +108,9 @@ consumer( Data &data, TheBuffer &buffer )
 #if LIMITRATE   
    const float serviceTime( 5e-6 );
 #endif   
-   RBSignal signal( RBSignal::NONE );
-   while( signal != RBSignal::RBEOF )
+   /** pop leaves current_count alone once drained **/
+   while( buffer.pop( current_count ) )
    {
-      buffer.pop( current_count, &signal );
 #if LIMITRATE
       const auto endTime( serviceTime + system_clock->getTime() );
       while( endTime > system_clock->getTime() );
@@ -99,9 +125,21 @@ std::string test()
 {
    double total_seconds( 0.0 );
 #ifdef USESharedMemory
-   char shmkey[ 256 ];
-   SHM::GenKey( shmkey, 256 );
-   std::string key( shmkey );
+   /** 
+    * anonymous (memfd) clock and queue, built before the fork so
+    * the child inherits their fds, nothing is named in /dev/shm
+    */
+   SystemClock< TSC > *shared_clock( new SystemClock< TSC >( -1, 
+                                                             Direction::Producer ) );
+   system_clock = shared_clock;
+   TheBuffer *buffer_a( new TheBuffer( BUFFSIZE, 
+                                       -1, 
+                                       Direction::Producer ) );
+#if TRACELATENCY
+   buffer_a->trace( nullptr, TRACEEVERY );
+#endif
+   /** don't let the child flush our buffered output a second time **/
+   std::cout.flush();
    ProcWait *proc_wait( new ProcWait( 1 ) ); 
    const pid_t child( fork() );
    double start( 0.0 );
@@ -109,12 +147,26 @@ std::string test()
    {
       case( 0 /* CHILD */ ):
       {
+         /** same timebase as the parent, whatever clock it fell back to **/
+         system_clock = new SystemClock< TSC >( shared_clock->getFd(), 
+                                                Direction::Consumer );
          TheBuffer buffer_b( BUFFSIZE,
-                             key, 
-                             Direction::Consumer, 
-                             false);
+                             buffer_a->fd(), 
+                             Direction::Consumer );
+#if TRACELATENCY
+         buffer_b.trace( &latency, TRACEEVERY );
+#endif
          /** call consumer function directly **/
-         consumer( buffer_b );
+         consumer( data, buffer_b );
+#if TRACELATENCY
+         /** the histogram lives in this process, report it from here **/
+         std::cout << "Latency (ns): ";
+         latency.print( std::cout ) << "\n";
+#endif
+#ifdef RB_WAIT_STATS
+         print_waits( std::cout, "Consumer",
+                      buffer_b.wait_stats( Direction::Consumer ) );
+#endif
          exit( EXIT_SUCCESS );
       }
       break;
@@ -128,13 +180,14 @@ std::string test()
       {
           
          proc_wait->AddProcess( child );
-         TheBuffer buffer_a( BUFFSIZE,
-                             key, 
-                             Direction::Producer, 
-                             false);
          start = system_clock->getTime();
          /** call producer directly **/
-         producer( data, buffer_a );
+         producer( data, *buffer_a );
+#ifdef RB_WAIT_STATS
+         print_waits( std::cout, "Producer",
+                      buffer_a->wait_stats( Direction::Producer ) );
+#endif
+         delete( buffer_a );
       }
    }
   
@@ -143,9 +196,15 @@ std::string test()
    const auto end( system_clock->getTime() );
    total_seconds = (end - start);
    delete( proc_wait );
+   delete( system_clock );
+   system_clock = nullptr;
    
 #elif defined USELOCAL
    TheBuffer buffer( BUFFSIZE );
+#if TRACELATENCY
+   latency.reset();
+   buffer.trace( &latency, TRACEEVERY );
+#endif
    std::thread a( producer, 
                   std::ref( data ), 
                   std::ref( buffer ) );
@@ -156,10 +215,22 @@ std::string test()
    a.join();
    b.join();
    total_seconds = ( data.end_time - data.start_time );
+#ifdef RB_WAIT_STATS
+   std::stringstream waits;
+   print_waits( waits, "Producer", buffer.wait_stats( Direction::Producer ) );
+   print_waits( waits, "Consumer", buffer.wait_stats( Direction::Consumer ) );
+#endif
 #endif
    std::stringstream ss;
    ss << "Time: " << total_seconds << "s\n";
    ss << "Rate: " << (( MAX_VAL * sizeof( std::int64_t ) ) / std::pow(2,20) ) / total_seconds << " MB/s\n";
+#if TRACELATENCY && defined USELOCAL
+   ss << "Latency (ns): ";
+   latency.print( ss ) << "\n";
+#endif
+#if defined RB_WAIT_STATS && ! defined USESharedMemory
+   ss << waits.str();
+#endif
    ss << "\n";
    return( ss.str() );
 }
@@ -63,13 +63,13 @@ struct TestData
 #define BUFFSIZE 100
 
 #ifdef USESharedMemory
-typedef RingBuffer< std::int64_t, RingBufferType::SharedMemory, BUFFSIZE > TheBuffer;
+typedef RingBuffer< TestData, RingBufferType::SharedMemory > TheBuffer;
 #elif defined USELOCAL
 typedef RingBuffer< TestData >  TheBuffer;
 #endif
 
 
-Clock *system_clock = new SystemClock< Cycle >( 1 );
+Clock *system_clock = new SystemClock< TSC >( 1 );
 
 
 void
@@ -81,7 +81,7 @@ producer( Data &data, TheBuffer &buffer )
    {
       buffer.push( d , 
          (current_count == data.send_count ? 
-          RBSignal::RBEOF : RBSignal::RBNONE ) );
+          RBSignal::RBEOF : RBSignal::NONE ) );
    }
    return;
 }
@@ -89,9 +89,11 @@ void
 consumer( Data &data , TheBuffer &buffer )
 {
    TestData test_object;
-   while( buffer.get_signal() != RBSignal::RBEOF )
+   TestData current_count;
+   RBSignal signal( RBSignal::NONE );
+   while( signal != RBSignal::RBEOF )
    {
-      auto current_count = buffer.pop();
+      buffer.pop( current_count, &signal );
       if( ! (test_object == current_count) )
       {
       	std::cerr << "Not equal, current value is: \n";
@@ -105,27 +107,25 @@ void test()
 {
 #ifdef USESharedMemory
    char shmkey[ 256 ];
-   SharedMemory::GenKey( shmkey, 256 );
+   SHM::GenKey( shmkey, 256 );
    std::string key( shmkey );
    
-   RingBuffer< std::int64_t, 
-               RingBufferType::SharedMemory, 
-               BUFFSIZE > buffer_a( key, 
-                                    Direction::Producer, 
-                                    false);
-   RingBuffer< std::int64_t, 
-              RingBufferType::SharedMemory, 
-              BUFFSIZE > buffer_b( key, 
-                                   Direction::Consumer, 
-                                   false);
-
-   std::thread a( producer, 
-                  std::ref( data ), 
-                  std::ref( buffer_a ) );
+   /** each end handshakes with the other while constructing **/
+   std::thread a( [&]()
+   {
+      TheBuffer buffer_a( BUFFSIZE, 
+                          key, 
+                          Direction::Producer );
+      producer( data, buffer_a );
+   } );
 
-   std::thread b( consumer, 
-                  std::ref( data ), 
-                  std::ref( buffer_b ) );
+   std::thread b( [&]()
+   {
+      TheBuffer buffer_b( BUFFSIZE, 
+                          key, 
+                          Direction::Consumer );
+      consumer( data, buffer_b );
+   } );
 
    
 #elif defined USELOCAL
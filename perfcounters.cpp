@@ -0,0 +1,196 @@
+/**
+ * perfcounters.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 18:40:26 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstring>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#if __linux
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+#include "perfcounters.hpp"
+
+CounterSample::CounterSample()
+{
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      value[ i ] = 0;
+      valid[ i ] = false;
+   }
+}
+
+static std::uint64_t
+rusage_switches()
+{
+#ifdef RUSAGE_THREAD
+   struct rusage usage;
+   std::memset( &usage, 0, sizeof( usage ) );
+   getrusage( RUSAGE_THREAD, &usage );
+   return( (std::uint64_t) ( usage.ru_nvcsw + usage.ru_nivcsw ) );
+#else
+   return( 0 );
+#endif
+}
+
+PerfCounters::PerfCounters() : switches_base( 0 )
+{
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      fd[ i ] = -1;
+   }
+#if __linux
+   fd[ Cycles ]       = open_event( PERF_TYPE_HARDWARE,
+                                    PERF_COUNT_HW_CPU_CYCLES,
+                                    true );
+   fd[ Instructions ] = open_event( PERF_TYPE_HARDWARE,
+                                    PERF_COUNT_HW_INSTRUCTIONS,
+                                    true );
+   fd[ L1DMisses ]    = open_event( PERF_TYPE_HW_CACHE,
+                                    PERF_COUNT_HW_CACHE_L1D |
+                                    ( PERF_COUNT_HW_CACHE_OP_READ << 8 ) |
+                                    ( PERF_COUNT_HW_CACHE_RESULT_MISS << 16 ),
+                                    true );
+   fd[ LLCMisses ]    = open_event( PERF_TYPE_HARDWARE,
+                                    PERF_COUNT_HW_CACHE_MISSES,
+                                    true );
+   const char *hitm( getenv( "RB_PERF_HITM" ) );
+   if( hitm != nullptr )
+   {
+      fd[ HITM ]      = open_event( PERF_TYPE_RAW,
+                                    std::strtoull( hitm, nullptr, 16 ),
+                                    true );
+   }
+   /** switches happen in the kernel, excluding it counts nothing **/
+   fd[ ContextSwitches ] = open_event( PERF_TYPE_SOFTWARE,
+                                       PERF_COUNT_SW_CONTEXT_SWITCHES,
+                                       false );
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      if( fd[ i ] >= 0 )
+      {
+         close( fd[ i ] );
+      }
+   }
+}
+
+void
+PerfCounters::start()
+{
+   switches_base = rusage_switches();
+#if __linux
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      if( fd[ i ] >= 0 )
+      {
+         ioctl( fd[ i ], PERF_EVENT_IOC_RESET, 0 );
+         ioctl( fd[ i ], PERF_EVENT_IOC_ENABLE, 0 );
+      }
+   }
+#endif
+}
+
+void
+PerfCounters::stop( CounterSample &sample )
+{
+#if __linux
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      if( fd[ i ] >= 0 )
+      {
+         ioctl( fd[ i ], PERF_EVENT_IOC_DISABLE, 0 );
+      }
+   }
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      sample.valid[ i ] = false;
+      if( fd[ i ] < 0 )
+      {
+         continue;
+      }
+      /** value, time enabled, time running **/
+      std::uint64_t buffer[ 3 ] = { 0, 0, 0 };
+      if( read( fd[ i ], buffer, sizeof( buffer ) ) != sizeof( buffer ) )
+      {
+         continue;
+      }
+      if( buffer[ 2 ] == 0 )
+      {
+         /** never got scheduled on the pmu, nothing to scale **/
+         continue;
+      }
+      sample.value[ i ] = ( buffer[ 2 ] < buffer[ 1 ] ?
+         (std::uint64_t) ( (double) buffer[ 0 ] *
+                           ( (double) buffer[ 1 ] / (double) buffer[ 2 ] ) ) :
+         buffer[ 0 ] );
+      sample.valid[ i ] = true;
+   }
+#endif
+   if( fd[ ContextSwitches ] < 0 )
+   {
+#ifdef RUSAGE_THREAD
+      sample.value[ ContextSwitches ] = rusage_switches() - switches_base;
+      sample.valid[ ContextSwitches ] = true;
+#endif
+   }
+}
+
+const char*
+PerfCounters::getName( const Counter counter )
+{
+   switch( counter )
+   {
+      case( Cycles ):            return( "cycles" );
+      case( Instructions ):      return( "instructions" );
+      case( L1DMisses ):         return( "l1d_misses" );
+      case( LLCMisses ):         return( "llc_misses" );
+      case( HITM ):              return( "hitm" );
+      case( ContextSwitches ):   return( "context_switches" );
+      default:                   return( "unknown" );
+   }
+}
+
+int
+PerfCounters::open_event( const std::uint32_t type,
+                          const std::uint64_t config,
+                          const bool exclude_kernel )
+{
+#if __linux
+   struct perf_event_attr attr;
+   std::memset( &attr, 0, sizeof( attr ) );
+   attr.size           = sizeof( attr );
+   attr.type           = type;
+   attr.config         = config;
+   attr.disabled       = 1;
+   attr.exclude_kernel = ( exclude_kernel ? 1 : 0 );
+   attr.exclude_hv     = 1;
+   attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED |
+                         PERF_FORMAT_TOTAL_TIME_RUNNING;
+   /** this thread, any cpu it runs on **/
+   return( (int) syscall( SYS_perf_event_open, &attr, 0, -1, -1, 0 ) );
+#else
+   return( -1 );
+#endif
+}
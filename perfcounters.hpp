@@ -0,0 +1,94 @@
+/**
+ * perfcounters.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 18:40:26 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _PERFCOUNTERS_HPP_
+#define _PERFCOUNTERS_HPP_  1
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * enum Counter - the events PerfCounters tries to open.  HITM
+ * (loads that hit a line modified in another core's cache, i.e.
+ * cache line transfers) has no generic perf event, it is only
+ * opened when RB_PERF_HITM holds the raw event for this cpu in
+ * perf's hex format, e.g. RB_PERF_HITM=0x04d2 on Skylake.
+ */
+enum Counter {
+   Cycles = 0,
+   Instructions,
+   L1DMisses,
+   LLCMisses,
+   HITM,
+   ContextSwitches,
+   CounterN
+};
+
+/**
+ * CounterSample - what one endpoint counted, valid is false for
+ * events the kernel or cpu wouldn't give us.
+ */
+struct CounterSample
+{
+   CounterSample();
+
+   std::uint64_t  value[ CounterN ];
+   bool           valid[ CounterN ];
+};
+
+/**
+ * PerfCounters - hardware counters for the calling thread only,
+ * opened with perf_event_open at construction and counting from
+ * start() to stop().  User space only so the default
+ * perf_event_paranoid setting is enough.  Counts are scaled when
+ * the kernel had to multiplex the events.  Anything that fails to
+ * open is simply left out, context switches fall back to
+ * getrusage() when the software event isn't allowed.
+ */
+class PerfCounters
+{
+public:
+   PerfCounters();
+   virtual ~PerfCounters();
+
+   /** zero and enable every open counter **/
+   void start();
+
+   /**
+    * stop - disable the counters and read them.
+    * @param sample - CounterSample&, filled in
+    */
+   void stop( CounterSample &sample );
+
+   /**
+    * getName - short name, used for output columns
+    * @param counter - const Counter
+    * @return const char*
+    */
+   static const char* getName( const Counter counter );
+
+private:
+   static int  open_event( const std::uint32_t type,
+                           const std::uint64_t config,
+                           const bool exclude_kernel );
+
+   int            fd[ CounterN ];
+   /** context switches at start() when read from getrusage **/
+   std::uint64_t  switches_base;
+};
+#endif /* END _PERFCOUNTERS_HPP_ */
@@ -18,12 +18,9 @@
  * limitations under the License.
  */
 #include "pointer.hpp"
-#include <thread>
 
-Pointer::Pointer(const size_t cap ) : a( 0 ),
-                                      b( 0 ),
-                                      wrap_a( 0 ),
-                                      wrap_b( 0 ),
+Pointer::Pointer(const size_t cap ) : index( 0 ),
+                                      wrap( 0 ),
                                       max_cap( cap )
 {
 }
@@ -31,53 +28,32 @@ Pointer::Pointer(const size_t cap ) : a( 0 ),
 size_t 
 Pointer::val( Pointer *ptr )
 {
-   struct{
-      size_t a;
-      size_t b;
-   }copy;
-   do{
-      copy.a = ptr->a;
-      copy.b = ptr->b;
-   }while( copy.a ^ copy.b );
-   return( copy.b );
+   return( ptr->index.load( std::memory_order_acquire ) );
 }
 
 size_t 
 Pointer::inc( Pointer *ptr )
 {
-   ptr->a = ( ptr->a + 1 ) % ptr->max_cap;
-   ptr->b = ( ptr->b + 1 ) % ptr->max_cap;
-   if( ptr->b == 0 )
-   {
-      ptr->wrap_a++;
-      ptr->wrap_b++;
-   }
-   return( ptr->b );
+   return( Pointer::incBy( 1, ptr ) );
 }
 
 size_t 
 Pointer::incBy( const size_t in, Pointer *ptr )
 {
-   ptr->a = ( ptr->a + in ) % ptr->max_cap;
-   ptr->b = ( ptr->b + in ) % ptr->max_cap;
-   if( ptr->b < in )
+   /** only the owning end writes, no need for an atomic add **/
+   const size_t next(
+      ( ptr->index.load( std::memory_order_relaxed ) + in ) % ptr->max_cap );
+   ptr->index.store( next, std::memory_order_release );
+   if( next < in )
    {
-      ptr->wrap_a++;
-      ptr->wrap_b++;
+      ptr->wrap.store( ptr->wrap.load( std::memory_order_relaxed ) + 1,
+                       std::memory_order_release );
    }
-   return( ptr->b );
+   return( next );
 }
 
 size_t 
 Pointer::wrapIndicator( Pointer *ptr )
 {
-   struct{
-      size_t a;
-      size_t b;
-   }copy;
-   do{
-      copy.a = ptr->wrap_a;
-      copy.b = ptr->wrap_b;
-   }while( copy.a ^ copy.b );
-   return( copy.b );
+   return( ptr->wrap.load( std::memory_order_acquire ) );
 }
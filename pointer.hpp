@@ -20,6 +20,7 @@
 #ifndef _POINTER_HPP_
 #define _POINTER_HPP_  1
 
+#include <atomic>
 #include <cstdlib>
 #include <cstdint>
 
@@ -28,19 +29,23 @@ public:
    /**
     * Pointer - used to synchronize read and write
     * pointers for the ring buffer.  This class encapsulates
-    * wrapping.
+    * wrapping.  Each pointer has exactly one writer (the end
+    * that owns it), so updates are plain release stores rather
+    * than read-modify-writes, and readers acquire.  The index is
+    * stored before the wrap count and published_size() loads the
+    * wrap first, so a reader caught between the two sees the
+    * queue emptier (consumer) or fuller (producer) than it is,
+    * never the other way round.
     */
    Pointer( const size_t cap );
 
    /**
-    * val - returns the current value of val.  Internally
-    * the function checks to ensure that any writes to the
-    * pointer have fully completed so that the value returned
-    * is ensured to be the correct one.  This is important
-    * as it means the producer will only see a "conservative"
-    * estimate of how many items can be written and the 
-    * consumer will only see a "conservative" estimate of how
-    * many items can be read.
+    * val - returns the current value of val.  The load acquires,
+    * so every item written before the matching inc()/incBy() is
+    * visible once its index is.  This is important as it means
+    * the producer will only see a "conservative" estimate of how
+    * many items can be written and the consumer will only see a
+    * "conservative" estimate of how many items can be read.
     * @return size_t, current 'true' value of the pointer
     */
    static size_t val( Pointer *ptr );
@@ -73,8 +78,7 @@ public:
    static size_t wrapIndicator( Pointer *ptr );
    
 private:
-   volatile std::uint64_t           a;
-   volatile std::uint64_t           b;
+   std::atomic< std::uint64_t >     index;
    /**
     * size of wrap pointer might become an issue
     * if GHz increase drastically or if this runs
@@ -82,8 +86,7 @@ private:
     * TODO, get these set correctly if we do eventually
     * wrap an unsigned 64 int.
     */
-   volatile std::uint64_t    wrap_a;
-   volatile std::uint64_t    wrap_b;
-   const    size_t           max_cap;
+   std::atomic< std::uint64_t >     wrap;
+   const    size_t                  max_cap;
 };
 #endif /* END _POINTER_HPP_ */
@@ -0,0 +1,437 @@
+/**
+ * queuearena.tcc - many ring buffers carved out of one heap or SHM
+ * region, with a directory so other threads or processes can find
+ * them by name.  A plain RingBuffer costs four heap allocations or
+ * three SHM segments, an arena costs one for the whole graph.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 21:48:09 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _QUEUEARENA_TCC_
+#define _QUEUEARENA_TCC_  1
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <string>
+#include <thread>
+#include "ringbufferbase.tcc"
+#include "region.tcc"
+
+/**
+ * ArenaRingBuffer - a RingBufferBase over a queue that lives in a
+ * QueueArena.  Deleting it only drops this view, the queue stays
+ * in the arena, so ends should close() / abandon() explicitly.
+ */
+template < class T, RingBufferType type > class ArenaRingBuffer :
+   public RingBufferBase< T, type >
+{
+public:
+   ArenaRingBuffer( const Buffer::Carved &pieces,
+                    const size_t max_cap ) : RingBufferBase< T, type >()
+   {
+      (this)->data = new Buffer::Data< T, type >( pieces, max_cap );
+   }
+
+   virtual ~ArenaRingBuffer()
+   {
+      delete( (this)->data );
+      (this)->data = nullptr;
+   }
+};
+
+/**
+ * QueueArena - the region starts with a header and a fixed size
+ * directory, queues are bump allocated after it and never freed
+ * before the arena is.  Each queue gets its read and write
+ * Pointers and its Control on their own cache lines followed by
+ * the signal and item arrays.
+ *
+ * The directory is open addressed on a hash of the name and slots
+ * only ever go Free -> Claimed -> Ready, so inserts are a CAS and
+ * two creators of the same name always race for the same slot.
+ * A slot left Claimed by a creator that died part way is skipped
+ * once it has been Claimed for over a second.
+ * Any thread or process attached to the arena may create or open
+ * queues.  The heap arena is for threads of one process, for SHM
+ * the Producer creates the segment (and removes it on
+ * destruction) and Consumers attach.
+ */
+template < RingBufferType type > class QueueArena
+{
+public:
+   /** longest queue name, including the terminating nul **/
+   static const size_t name_length = 48;
+
+   /**
+    * QueueArena - heap backed.
+    * @param bytes   - const size_t, total size including directory
+    * @param entries - const size_t, max number of queues
+    */
+   QueueArena( const size_t bytes,
+               const size_t entries = 1024 ) :
+      region( new Buffer::Region< type >( bytes ) ),
+      header( nullptr ),
+      directory( nullptr )
+   {
+      format( entries );
+   }
+
+   /**
+    * QueueArena - SHM backed, both sides pass the same bytes.
+    * @param bytes   - const size_t
+    * @param key     - const std::string, SHM key for the arena
+    * @param dir     - Direction, Producer creates, Consumer attaches
+    * @param entries - const size_t, Producer only
+    */
+   QueueArena( const size_t bytes,
+               const std::string key,
+               Direction dir,
+               const size_t entries = 1024 ) :
+      region( new Buffer::Region< type >( bytes, key, dir ) ),
+      header( nullptr ),
+      directory( nullptr )
+   {
+      if( dir == Direction::Producer )
+      {
+         format( entries );
+      }
+      else
+      {
+         attach();
+      }
+   }
+
+   virtual ~QueueArena()
+   {
+      header    = nullptr;
+      directory = nullptr;
+      delete( region );
+      region = nullptr;
+   }
+
+   /**
+    * create - carve a queue of nitems T out of the arena and
+    * publish it under name.  Exits if the name is taken, too
+    * long, or the arena or its directory is full.  The space is
+    * taken before the directory slot, so running out of it never
+    * strands a Claimed slot.
+    * @param name   - const std::string&
+    * @param nitems - const size_t
+    * @return ArenaRingBuffer*, caller deletes the view
+    */
+   template < class T >
+   ArenaRingBuffer< T, type >* create( const std::string &name,
+                                       const size_t nitems )
+   {
+      if( name.length() == 0 || name.length() >= name_length )
+      {
+         std::cerr << "Arena queue names must be 1 to " << ( name_length - 1 ) <<
+            " characters, got \"" << name << "\", exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      const std::uint64_t offset( reserve( name, queue_length< T >( nitems ) ) );
+      Entry &entry( claim( name ) );
+      const Buffer::Carved pieces( carve< T >( offset, nitems ) );
+      new ( pieces.read_pt )  Pointer( nitems );
+      new ( pieces.write_pt ) Pointer( nitems );
+      new ( pieces.control )  Buffer::Control();
+      entry.element_size = sizeof( T );
+      entry.max_cap      = nitems;
+      entry.offset       = offset;
+      entry.state.store( Ready, std::memory_order_release );
+      return( new ArenaRingBuffer< T, type >( pieces, nitems ) );
+   }
+
+   /**
+    * open - find the queue published under name, waiting up to
+    * timeout for some other thread or process to create it.
+    * Exits if it never shows up or holds something other than T.
+    * @param name    - const std::string&
+    * @param timeout - std::chrono::milliseconds, default 10s
+    * @return ArenaRingBuffer*, caller deletes the view
+    */
+   template < class T >
+   ArenaRingBuffer< T, type >* open( const std::string &name,
+                                     const std::chrono::milliseconds timeout =
+                                        std::chrono::milliseconds( 10000 ) )
+   {
+      const auto deadline( std::chrono::steady_clock::now() + timeout );
+      Entry *entry( nullptr );
+      while( ( entry = find( name ) ) == nullptr )
+      {
+         if( std::chrono::steady_clock::now() > deadline )
+         {
+            std::cerr << "Timed out waiting for arena queue \"" << name <<
+               "\", exiting!!\n";
+            exit( EXIT_FAILURE );
+         }
+         std::this_thread::yield();
+      }
+      if( entry->element_size != sizeof( T ) )
+      {
+         std::cerr << "Arena queue \"" << name << "\" holds " <<
+            entry->element_size << " byte items, asked for " << sizeof( T ) <<
+            ", exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      return( new ArenaRingBuffer< T, type >( carve< T >( entry->offset,
+                                                          entry->max_cap ),
+                                              entry->max_cap ) );
+   }
+
+   /**
+    * contains - true if name has been published, never waits.
+    * @param name - const std::string&
+    * @return bool
+    */
+   bool contains( const std::string &name )
+   {
+      return( find( name ) != nullptr );
+   }
+
+   /** bytes still free for queues, racy but fine for sizing **/
+   size_t available() const
+   {
+      const std::uint64_t used( header->used.load( std::memory_order_relaxed ) );
+      return( used < header->length ? header->length - used : 0 );
+   }
+
+   /**
+    * queue_length - arena bytes a queue of nitems T takes up,
+    * for sizing the arena up front.
+    * @param nitems - const size_t
+    * @return size_t
+    */
+   template < class T > static size_t queue_length( const size_t nitems )
+   {
+      return( ( round_line( sizeof( Pointer ) ) * 2 ) +
+              round_line( sizeof( Buffer::Control ) ) +
+              round_line( sizeof( Buffer::Signal ) * nitems ) +
+              round_line( sizeof( Buffer::Element< T > ) * nitems ) );
+   }
+
+   /**
+    * directory_length - bytes of header and directory in front
+    * of the queues for the given number of entries.
+    * @param entries - const size_t
+    * @return size_t
+    */
+   static size_t directory_length( const size_t entries )
+   {
+      return( round_line( sizeof( Header ) + ( sizeof( Entry ) * entries ) ) );
+   }
+
+protected:
+   enum State : std::uint32_t { Free = 0, Claimed, Ready };
+
+   struct Entry
+   {
+      std::atomic< std::uint32_t >  state;
+      std::uint32_t                 element_size;
+      std::uint64_t                 max_cap;
+      std::uint64_t                 offset;
+      char                          name[ name_length ];
+   };
+
+   struct Header
+   {
+      /** "QARN", written last by the creator **/
+      std::atomic< std::uint32_t >  magic;
+      std::uint32_t                 entries;
+      std::uint64_t                 length;
+      /** next free byte, from the start of the region **/
+      alignas( 64 ) std::atomic< std::uint64_t >  used;
+   };
+
+   static const std::uint32_t magic_value = 0x5141524e;
+
+   static size_t round_line( const size_t bytes )
+   {
+      return( ( bytes + 63 ) & ~( (size_t) 63 ) );
+   }
+
+   /** FNV-1a, the directory is small, anything that spreads will do **/
+   static std::uint64_t hash( const std::string &name )
+   {
+      std::uint64_t h( 0xcbf29ce484222325ULL );
+      for( const char c : name )
+      {
+         h = ( h ^ (std::uint8_t) c ) * 0x100000001b3ULL;
+      }
+      return( h );
+   }
+
+   void format( const size_t entries )
+   {
+      char *base( reinterpret_cast< char* >( region->ptr ) );
+      if( entries == 0 || directory_length( entries ) >= region->length )
+      {
+         std::cerr << "Queue arena of (" << region->length <<
+            ") bytes can't hold a directory of (" << entries <<
+            ") entries, exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      /** region memory starts zeroed, so every entry starts Free **/
+      header            = new ( base ) Header();
+      header->entries   = (std::uint32_t) entries;
+      header->length    = region->length;
+      header->used.store( directory_length( entries ), std::memory_order_relaxed );
+      directory         = reinterpret_cast< Entry* >( base + sizeof( Header ) );
+      header->magic.store( magic_value, std::memory_order_release );
+   }
+
+   void attach()
+   {
+      char *base( reinterpret_cast< char* >( region->ptr ) );
+      header = reinterpret_cast< Header* >( base );
+      const auto deadline( std::chrono::steady_clock::now() +
+                           std::chrono::seconds( 10 ) );
+      while( header->magic.load( std::memory_order_acquire ) != magic_value )
+      {
+         if( std::chrono::steady_clock::now() > deadline )
+         {
+            std::cerr << "Timed out waiting for the arena creator, exiting!!\n";
+            exit( EXIT_FAILURE );
+         }
+         std::this_thread::yield();
+      }
+      if( header->length != region->length )
+      {
+         std::cerr << "Queue arena is (" << header->length << ") bytes, asked for (" <<
+            region->length << "), exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      directory = reinterpret_cast< Entry* >( base + sizeof( Header ) );
+   }
+
+   /**
+    * settled - wait out a creator between claiming a slot and
+    * publishing it, a handful of stores.  Still Claimed after a
+    * second the creator died there, returns Claimed and callers
+    * skip the slot.
+    */
+   static std::uint32_t settled( const Entry &entry )
+   {
+      std::uint32_t state( entry.state.load( std::memory_order_acquire ) );
+      if( state != Claimed )
+      {
+         return( state );
+      }
+      const auto deadline( std::chrono::steady_clock::now() +
+                           std::chrono::seconds( 1 ) );
+      while( state == Claimed && std::chrono::steady_clock::now() < deadline )
+      {
+         std::this_thread::yield();
+         state = entry.state.load( std::memory_order_acquire );
+      }
+      return( state );
+   }
+
+   /** bump allocate length bytes, exits without taking any if they don't fit **/
+   std::uint64_t reserve( const std::string &name, const size_t length )
+   {
+      std::uint64_t offset( header->used.load( std::memory_order_relaxed ) );
+      do
+      {
+         if( offset + length > header->length )
+         {
+            std::cerr << "Queue arena is out of space creating \"" << name <<
+               "\" (" << length << " bytes), exiting!!\n";
+            exit( EXIT_FAILURE );
+         }
+      }while( ! header->used.compare_exchange_weak( offset,
+                                                    offset + length,
+                                                    std::memory_order_relaxed,
+                                                    std::memory_order_relaxed ) );
+      return( offset );
+   }
+
+   /** take the first Free slot on name's probe sequence **/
+   Entry& claim( const std::string &name )
+   {
+      const std::uint64_t start( hash( name ) );
+      for( std::uint32_t i( 0 ); i < header->entries; i++ )
+      {
+         Entry &entry( directory[ ( start + i ) % header->entries ] );
+         std::uint32_t expected( Free );
+         if( entry.state.compare_exchange_strong( expected,
+                                                  Claimed,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire ) )
+         {
+            std::strncpy( entry.name, name.c_str(), name_length - 1 );
+            return( entry );
+         }
+         if( settled( entry ) == Ready &&
+             std::strncmp( entry.name, name.c_str(), name_length ) == 0 )
+         {
+            std::cerr << "Arena queue \"" << name << "\" already exists, exiting!!\n";
+            exit( EXIT_FAILURE );
+         }
+      }
+      std::cerr << "Queue arena directory is full (" << header->entries <<
+         " entries), exiting!!\n";
+      exit( EXIT_FAILURE );
+   }
+
+   /** nullptr if name isn't Ready yet **/
+   Entry* find( const std::string &name )
+   {
+      const std::uint64_t start( hash( name ) );
+      for( std::uint32_t i( 0 ); i < header->entries; i++ )
+      {
+         Entry &entry( directory[ ( start + i ) % header->entries ] );
+         const std::uint32_t state( settled( entry ) );
+         if( state == Free )
+         {
+            return( nullptr );
+         }
+         if( state == Ready &&
+             std::strncmp( entry.name, name.c_str(), name_length ) == 0 )
+         {
+            return( &entry );
+         }
+      }
+      return( nullptr );
+   }
+
+   /** this process's addresses of the queue at offset **/
+   template < class T >
+   Buffer::Carved carve( const std::uint64_t offset, const size_t nitems )
+   {
+      char *queue( reinterpret_cast< char* >( region->ptr ) + offset );
+      Buffer::Carved pieces;
+      pieces.read_pt  = reinterpret_cast< Pointer* >( queue );
+      queue          += round_line( sizeof( Pointer ) );
+      pieces.write_pt = reinterpret_cast< Pointer* >( queue );
+      queue          += round_line( sizeof( Pointer ) );
+      pieces.control  = reinterpret_cast< Buffer::Control* >( queue );
+      queue          += round_line( sizeof( Buffer::Control ) );
+      pieces.signal   = reinterpret_cast< Buffer::Signal* >( queue );
+      queue          += round_line( sizeof( Buffer::Signal ) * nitems );
+      pieces.store    = queue;
+      return( pieces );
+   }
+
+   Buffer::Region< type >  *region;
+   Header                  *header;
+   Entry                   *directory;
+};
+#endif /* END _QUEUEARENA_TCC_ */
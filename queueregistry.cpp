@@ -0,0 +1,311 @@
+/**
+ * queueregistry.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 22:14:37 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <thread>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "futex.hpp"
+#include "shm.hpp"
+#include "queueregistry.hpp"
+
+/** FNV-1a, names only need spreading over the slots **/
+static std::uint64_t
+hash( const std::string &name )
+{
+   std::uint64_t h( 0xcbf29ce484222325ULL );
+   for( const char c : name )
+   {
+      h = ( h ^ (std::uint8_t) c ) * 0x100000001b3ULL;
+   }
+   return( h );
+}
+
+/**
+ * open_existing - map a registry some other process created,
+ * waiting for the creator's ftruncate to reach the full length.
+ */
+static void*
+open_existing( const std::string &registry, const size_t length )
+{
+   const auto deadline( std::chrono::steady_clock::now() +
+                        std::chrono::seconds( 10 ) );
+   while( std::chrono::steady_clock::now() < deadline )
+   {
+      const int fd( shm_open( registry.c_str(), O_RDWR, 0 ) );
+      if( fd >= 0 )
+      {
+         struct stat st;
+         void *out( MAP_FAILED );
+         if( fstat( fd, &st ) == 0 && (size_t) st.st_size >= length )
+         {
+            out = mmap( nullptr,
+                        length,
+                        ( PROT_READ | PROT_WRITE ),
+                        MAP_SHARED,
+                        fd,
+                        0 );
+         }
+         close( fd );
+         if( out != MAP_FAILED )
+         {
+            return( out );
+         }
+      }
+      std::this_thread::yield();
+   }
+   std::cerr << "Failed to open queue registry \"" << registry <<
+      "\": " << strerror( errno ) << ", exiting!!\n";
+   exit( EXIT_FAILURE );
+}
+
+QueueRegistry::QueueRegistry( const std::string registry ) : registry( registry ),
+                                                             directory( nullptr )
+{
+   bool created( false );
+   void *ptr( nullptr );
+   try
+   {
+      ptr     = SHM::Init( registry.c_str(), sizeof( Directory ) );
+      created = true;
+   }
+   catch( bad_shm_alloc &ex )
+   {
+      ptr = open_existing( registry, sizeof( Directory ) );
+   }
+   directory = reinterpret_cast< Directory* >( ptr );
+   if( created )
+   {
+      /** zeroed by SHM::Init, every slot starts Free **/
+      directory->magic.store( magic_value, std::memory_order_release );
+      return;
+   }
+   const auto deadline( std::chrono::steady_clock::now() +
+                        std::chrono::seconds( 10 ) );
+   while( directory->magic.load( std::memory_order_acquire ) != magic_value )
+   {
+      if( std::chrono::steady_clock::now() > deadline )
+      {
+         std::cerr << "Queue registry \"" << registry << "\" was never " <<
+            "initialized, remove it (QueueRegistry::remove), exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      std::this_thread::yield();
+   }
+}
+
+QueueRegistry::~QueueRegistry()
+{
+   SHM::Close( registry.c_str(),
+               (void*) directory,
+               sizeof( Directory ),
+               false,
+               false );
+   directory = nullptr;
+}
+
+std::string
+QueueRegistry::publish( const std::string &name, const Layout &layout )
+{
+   if( name.length() == 0 || name.length() >= name_length )
+   {
+      std::cerr << "Registry names must be 1 to " << ( name_length - 1 ) <<
+         " characters, got \"" << name << "\", exiting!!\n";
+      exit( EXIT_FAILURE );
+   }
+   const std::int32_t pid( getpid() );
+   Entry *entry( nullptr );
+   while( true )
+   {
+      entry = slot( name );
+      if( entry == nullptr )
+      {
+         std::cerr << "Queue registry \"" << registry << "\" is full (" <<
+            slots << " names), exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      std::uint32_t state( settled( *entry ) );
+      if( state == Ready && alive( entry->pid ) )
+      {
+         std::cerr << "Queue \"" << name << "\" is already published by pid (" <<
+            entry->pid << "), exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      /** Free, Withdrawn, or left behind by a dead publisher **/
+      if( entry->state.compare_exchange_strong( state,
+                                                claimed_by( pid ),
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_acquire ) )
+      {
+         break;
+      }
+   }
+   const std::string key( "rbqueue." + std::to_string( pid ) + "." +
+      std::to_string( directory->sequence.fetch_add( 1, std::memory_order_relaxed ) ) );
+   std::strncpy( entry->name, name.c_str(), name_length - 1 );
+   std::strncpy( entry->key,  key.c_str(),  name_length - 1 );
+   entry->pid           = pid;
+   entry->element_size  = layout.element_size;
+   entry->element_align = layout.element_align;
+   entry->signal_size   = layout.signal_size;
+   entry->capacity      = layout.capacity;
+   entry->state.store( Ready, std::memory_order_release );
+   directory->generation.fetch_add( 1, std::memory_order_release );
+   Futex::wake( &directory->generation );
+   return( key );
+}
+
+bool
+QueueRegistry::lookup( const std::string &name, Info &info )
+{
+   Entry *entry( slot( name ) );
+   if( entry == nullptr || settled( *entry ) != Ready ||
+       std::strncmp( entry->name, name.c_str(), name_length ) != 0 ||
+       ! alive( entry->pid ) )
+   {
+      return( false );
+   }
+   info.layout.element_size  = entry->element_size;
+   info.layout.element_align = entry->element_align;
+   info.layout.signal_size   = entry->signal_size;
+   info.layout.capacity      = entry->capacity;
+   info.key                  = entry->key;
+   info.pid                  = entry->pid;
+   /** republished while we read it, take the new one **/
+   if( entry->state.load( std::memory_order_acquire ) != Ready )
+   {
+      return( lookup( name, info ) );
+   }
+   return( true );
+}
+
+bool
+QueueRegistry::wait_for( const std::string &name,
+                         Info &info,
+                         const std::int64_t timeout_ns )
+{
+   const auto deadline( std::chrono::steady_clock::now() +
+                        std::chrono::nanoseconds( timeout_ns ) );
+   while( true )
+   {
+      /** read the generation first so a publish after lookup() wakes us **/
+      const std::uint32_t generation(
+         directory->generation.load( std::memory_order_acquire ) );
+      if( lookup( name, info ) )
+      {
+         return( true );
+      }
+      std::int64_t remaining( -1 );
+      if( timeout_ns >= 0 )
+      {
+         remaining = std::chrono::duration_cast< std::chrono::nanoseconds >(
+            deadline - std::chrono::steady_clock::now() ).count();
+         if( remaining <= 0 )
+         {
+            return( false );
+         }
+      }
+      Futex::wait( &directory->generation, generation, remaining );
+   }
+}
+
+void
+QueueRegistry::withdraw( const std::string &name )
+{
+   Entry *entry( slot( name ) );
+   std::uint32_t state( Ready );
+   if( entry != nullptr && entry->pid == getpid() &&
+       std::strncmp( entry->name, name.c_str(), name_length ) == 0 )
+   {
+      entry->state.compare_exchange_strong( state,
+                                            Withdrawn,
+                                            std::memory_order_acq_rel,
+                                            std::memory_order_relaxed );
+   }
+}
+
+bool
+QueueRegistry::remove( const std::string registry )
+{
+   return( shm_unlink( registry.c_str() ) == 0 );
+}
+
+std::uint32_t
+QueueRegistry::settled( Entry &entry )
+{
+   std::uint32_t state( entry.state.load( std::memory_order_acquire ) );
+   while( is_claimed( state ) )
+   {
+      const std::int32_t claimer( (std::int32_t) ( state >> 2 ) );
+      if( claimer <= 0 || ! alive( claimer ) )
+      {
+         /** died part way through publish(), the name may be half written **/
+         if( entry.state.compare_exchange_strong( state,
+                                                  Withdrawn,
+                                                  std::memory_order_acq_rel,
+                                                  std::memory_order_acquire ) )
+         {
+            return( Withdrawn );
+         }
+         continue;
+      }
+      std::this_thread::yield();
+      state = entry.state.load( std::memory_order_acquire );
+   }
+   return( state );
+}
+
+bool
+QueueRegistry::alive( const std::int32_t pid )
+{
+   errno = 0;
+   return( kill( pid, 0 ) == 0 || errno == EPERM );
+}
+
+QueueRegistry::Entry*
+QueueRegistry::slot( const std::string &name )
+{
+   const std::uint64_t start( hash( name ) );
+   /** first slot some other name left behind, reused if name isn't here **/
+   Entry *reusable( nullptr );
+   for( size_t i( 0 ); i < slots; i++ )
+   {
+      Entry &entry( directory->entries[ ( start + i ) % slots ] );
+      const std::uint32_t state( settled( entry ) );
+      if( state == Free )
+      {
+         return( reusable != nullptr ? reusable : &entry );
+      }
+      if( std::strncmp( entry.name, name.c_str(), name_length ) == 0 )
+      {
+         return( &entry );
+      }
+      if( reusable == nullptr &&
+          ( state == Withdrawn || ! alive( entry.pid ) ) )
+      {
+         reusable = &entry;
+      }
+   }
+   return( reusable );
+}
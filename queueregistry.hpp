@@ -0,0 +1,258 @@
+/**
+ * queueregistry.hpp - a small SHM directory of named queues, so
+ * the two ends of a SHM RingBuffer can meet by name instead of
+ * passing a random SHM::GenKey key around out of band.  Producers
+ * publish a name with the queue's layout and get back a key the
+ * registry guarantees is unique, consumers wait (on a futex, not a
+ * retry loop) for the name to show up and attach with its key.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 22:14:37 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _QUEUEREGISTRY_HPP_
+#define _QUEUEREGISTRY_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include "ringbuffer.tcc"
+
+/**
+ * QueueRegistry - the directory is one SHM segment of fixed size,
+ * created by whichever process gets there first and left in place
+ * for the next run (remove() deletes it).  Entries are open
+ * addressed on a hash of the name; a name stays in the slot it
+ * was first published in, or else takes the first reusable slot
+ * on its probe, so publishing is a CAS on that slot's state and
+ * two publishers of the same name always race for the same word.
+ * Slots of withdrawn names, and of names whose publisher has
+ * exited, are reused by any name probing past them, so a run of
+ * fresh names doesn't fill the directory.  A slot claimed by a
+ * publisher that died before finishing is handed back as
+ * Withdrawn by whoever finds it next.  Every publish bumps a
+ * futex word that wait_for() sleeps on.
+ */
+class QueueRegistry
+{
+public:
+   /** longest name, including the terminating nul **/
+   static const size_t name_length = 64;
+   /** number of directory slots **/
+   static const size_t slots       = 4096;
+
+   /**
+    * Layout - what a consumer must agree with to attach.  The
+    * signal size catches ends built with different RB_META_*
+    * settings.
+    */
+   struct Layout
+   {
+      Layout() : element_size( 0 ),
+                 element_align( 0 ),
+                 signal_size( 0 ),
+                 capacity( 0 )
+      {}
+
+      template < class T > static Layout of( const size_t capacity )
+      {
+         Layout layout;
+         layout.element_size  = sizeof( T );
+         layout.element_align = alignof( T );
+         layout.signal_size   = sizeof( Buffer::Signal );
+         layout.capacity      = capacity;
+         return( layout );
+      }
+
+      bool matches( const Layout &other ) const
+      {
+         return( element_size  == other.element_size  &&
+                 element_align == other.element_align &&
+                 signal_size   == other.signal_size );
+      }
+
+      std::uint32_t  element_size;
+      std::uint32_t  element_align;
+      std::uint32_t  signal_size;
+      std::uint64_t  capacity;
+   };
+
+   /** a published name as seen by lookup() **/
+   struct Info
+   {
+      Layout         layout;
+      /** SHM key to build the queue with **/
+      std::string    key;
+      std::int32_t   pid;
+   };
+
+   /**
+    * QueueRegistry - create or attach to the registry segment.
+    * @param registry - const std::string, SHM key of the directory,
+    *                   default "rbregistry"
+    */
+   QueueRegistry( const std::string registry = "rbregistry" );
+
+   virtual ~QueueRegistry();
+
+   /**
+    * publish - register name with layout and reserve a unique key
+    * for it.  Exits if a live process already published name or
+    * the directory is full.
+    * @param name   - const std::string&
+    * @param layout - const Layout&
+    * @return std::string - the key to build the queue with
+    */
+   std::string publish( const std::string &name, const Layout &layout );
+
+   /**
+    * lookup - find name, never waits.
+    * @param name - const std::string&
+    * @param info - Info&, filled in if found
+    * @return bool - true if name is published by a live process
+    */
+   bool lookup( const std::string &name, Info &info );
+
+   /**
+    * wait_for - lookup(), sleeping until name is published.
+    * @param name       - const std::string&
+    * @param info       - Info&
+    * @param timeout_ns - const std::int64_t, < 0 waits forever
+    * @return bool - false on timeout
+    */
+   bool wait_for( const std::string &name,
+                  Info &info,
+                  const std::int64_t timeout_ns = -1 );
+
+   /**
+    * withdraw - drop name, only the process that published it
+    * may.  Consumers that already attached are unaffected.
+    * @param name - const std::string&
+    */
+   void withdraw( const std::string &name );
+
+   /**
+    * create - publish name and build the producer end.  Like any
+    * SHM RingBuffer the constructor returns once the consumer
+    * has attached.
+    * @param name   - const std::string&
+    * @param nitems - const size_t
+    * @return RingBuffer*, caller deletes
+    */
+   template < class T >
+   RingBuffer< T, RingBufferType::SharedMemory >* create( const std::string &name,
+                                                          const size_t nitems )
+   {
+      const std::string key( publish( name, Layout::of< T >( nitems ) ) );
+      return( new RingBuffer< T, RingBufferType::SharedMemory >( nitems,
+                                                                 key,
+                                                                 Direction::Producer ) );
+   }
+
+   /**
+    * attach - wait for name and build the consumer end with the
+    * published capacity.  Exits if it doesn't hold T.
+    * @param name       - const std::string&
+    * @param timeout_ns - const std::int64_t, < 0 waits forever
+    * @return RingBuffer*, caller deletes, nullptr on timeout
+    */
+   template < class T >
+   RingBuffer< T, RingBufferType::SharedMemory >* attach( const std::string &name,
+                                                          const std::int64_t timeout_ns = -1 )
+   {
+      Info info;
+      if( ! wait_for( name, info, timeout_ns ) )
+      {
+         return( nullptr );
+      }
+      if( ! info.layout.matches( Layout::of< T >( info.layout.capacity ) ) )
+      {
+         std::cerr << "Queue \"" << name << "\" was published with " <<
+            info.layout.element_size << " byte items and " <<
+            info.layout.signal_size << " byte signals, asked for " <<
+            sizeof( T ) << " and " << sizeof( Buffer::Signal ) << ", exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      return( new RingBuffer< T, RingBufferType::SharedMemory >( info.layout.capacity,
+                                                                 info.key,
+                                                                 Direction::Consumer ) );
+   }
+
+   /**
+    * remove - delete the registry segment, existing mappings
+    * stay valid.
+    * @param registry - const std::string
+    * @return bool - true if it existed
+    */
+   static bool remove( const std::string registry = "rbregistry" );
+
+protected:
+   /**
+    * the two low bits of Entry::state, Claimed carries the
+    * claiming pid above them (see claimed_by()) so a claim left
+    * by a dead publisher can be recognized and taken back.
+    */
+   enum State : std::uint32_t { Free = 0, Claimed, Ready, Withdrawn };
+
+   static std::uint32_t claimed_by( const std::int32_t pid )
+   {
+      return( ( (std::uint32_t) pid << 2 ) | Claimed );
+   }
+
+   static bool is_claimed( const std::uint32_t state )
+   {
+      return( ( state & 3 ) == Claimed );
+   }
+
+   struct Entry
+   {
+      std::atomic< std::uint32_t >  state;
+      std::int32_t                  pid;
+      std::uint32_t                 element_size;
+      std::uint32_t                 element_align;
+      std::uint32_t                 signal_size;
+      std::uint64_t                 capacity;
+      char                          name[ name_length ];
+      char                          key[ name_length ];
+   };
+
+   struct Directory
+   {
+      /** "QREG", written last by the creator **/
+      std::atomic< std::uint32_t >  magic;
+      /** bumped on every publish, wait_for() sleeps on it **/
+      alignas( 64 ) std::atomic< std::uint32_t >  generation;
+      /** makes each published key unique **/
+      std::atomic< std::uint64_t >                sequence;
+      alignas( 64 ) Entry                         entries[ slots ];
+   };
+
+   static const std::uint32_t magic_value = 0x51524547;
+
+   /**
+    * settled - wait out a publisher between claiming a slot and
+    * publishing, never returns a Claimed state.  A claim whose
+    * pid has exited is turned into Withdrawn.
+    */
+   static std::uint32_t settled( Entry &entry );
+   static bool alive( const std::int32_t pid );
+   /** the slot name lives in, or the reusable or Free slot it would take **/
+   Entry* slot( const std::string &name );
+
+   const std::string  registry;
+   Directory         *directory;
+};
+#endif /* END _QUEUEREGISTRY_HPP_ */
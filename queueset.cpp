@@ -0,0 +1,164 @@
+/**
+ * queueset.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 11:58:30 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <chrono>
+#include "futex.hpp"
+#include "queueset.hpp"
+#include "spinwait.hpp"
+
+QueueSet::QueueSet( const std::int64_t sleep_slice_ns,
+                    const size_t       spin ) : cursor( 0 ),
+                                                sleep_slice_ns( sleep_slice_ns ),
+                                                spin( spin )
+{
+   /** nothing to do **/
+}
+
+QueueSet::~QueueSet()
+{
+   /** queues are owned elsewhere, just stop watching them **/
+   for( Entry &entry : entries )
+   {
+      entry.watched->fetch_sub( 1, std::memory_order_relaxed );
+   }
+}
+
+size_t
+QueueSet::size() const
+{
+   return( entries.size() );
+}
+
+size_t
+QueueSet::poll( std::vector< size_t > &ready )
+{
+   ready.clear();
+   const size_t n( entries.size() );
+   for( size_t i( 0 ); i < n; i++ )
+   {
+      const size_t index( ( cursor + i ) % n );
+      if( entries[ index ].ready() )
+      {
+         ready.push_back( index );
+      }
+   }
+   if( ready.size() > 0 )
+   {
+      /** first ready queue this time goes to the back next time **/
+      cursor = ( ready[ 0 ] + 1 ) % n;
+   }
+   return( ready.size() );
+}
+
+size_t
+QueueSet::wait( std::vector< size_t > &ready,
+                const std::int64_t timeout_ns )
+{
+   typedef std::chrono::steady_clock clock_type;
+   if( poll( ready ) > 0 )
+   {
+      return( ready.size() );
+   }
+   const auto start( clock_type::now() );
+   std::uint64_t spins( 0 );
+   std::uint64_t sleeps( 0 );
+   auto done = [&]( const size_t n )
+   {
+      charge( spins,
+              sleeps,
+              std::chrono::duration_cast< std::chrono::nanoseconds >(
+                 clock_type::now() - start ).count() );
+      return( n );
+   };
+   while( true )
+   {
+      for( size_t i( 0 ); i < spin; i++ )
+      {
+         if( poll( ready ) > 0 )
+         {
+            return( done( ready.size() ) );
+         }
+         spin_pause();
+         spins++;
+      }
+      std::int64_t slice( sleep_slice_ns );
+      if( timeout_ns >= 0 )
+      {
+         const std::int64_t elapsed(
+            std::chrono::duration_cast< std::chrono::nanoseconds >(
+               clock_type::now() - start ).count() );
+         if( elapsed >= timeout_ns )
+         {
+            return( done( poll( ready ) ) );
+         }
+         if( timeout_ns - elapsed < slice )
+         {
+            slice = timeout_ns - elapsed;
+         }
+      }
+      /**
+       * register as a waiter and snapshot the epochs before the
+       * final check so a publish after the check changes an epoch
+       * we're about to sleep on.
+       */
+      for( size_t i( 0 ); i < entries.size(); i++ )
+      {
+         entries[ i ].waiters->fetch_add( 1, std::memory_order_seq_cst );
+         expected[ i ] = entries[ i ].epoch->load( std::memory_order_acquire );
+      }
+      if( poll( ready ) == 0 )
+      {
+         Futex::waitAny( words.data(),
+                         expected.data(),
+                         words.size(),
+                         slice );
+         sleeps++;
+      }
+      for( size_t i( 0 ); i < entries.size(); i++ )
+      {
+         entries[ i ].waiters->fetch_sub( 1, std::memory_order_relaxed );
+      }
+      if( ready.size() > 0 || poll( ready ) > 0 )
+      {
+         return( done( ready.size() ) );
+      }
+   }
+}
+
+void
+QueueSet::charge( const std::uint64_t spins,
+                  const std::uint64_t sleeps,
+                  const std::uint64_t blocked_ns )
+{
+   for( Entry &entry : entries )
+   {
+      if( entry.stats != nullptr )
+      {
+         WaitStats::add( entry.stats->waits );
+         WaitStats::add( entry.stats->spins, spins );
+         WaitStats::add( entry.stats->sleeps, sleeps );
+         WaitStats::add( entry.stats->blocked_ns, blocked_ns );
+      }
+      if( entry.shared != nullptr )
+      {
+         QueueStats::add( entry.shared->waits );
+         QueueStats::add( entry.shared->blocked_ns, blocked_ns );
+      }
+   }
+}
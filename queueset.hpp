@@ -0,0 +1,187 @@
+/**
+ * queueset.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 11:58:30 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _QUEUESET_HPP_
+#define _QUEUESET_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+#include "ringbufferbase.tcc"
+#include "signalvars.hpp"
+
+/**
+ * Interest - what a QueueSet waits for on a given queue,
+ * Readable for the consumer end, Writable for the producer end.
+ */
+enum Interest { Readable, Writable };
+
+/**
+ * QueueSet - lets a single thread wait on many Heap or SHM
+ * queues at once.  wait() spins over the queues for a short
+ * while, then registers as a waiter on every queue and sleeps
+ * on all of their control words together (futex_waitv) until
+ * one of the other ends publishes.  Ready queues are returned
+ * starting just after the first ready queue of the previous
+ * call so a busy low index can't starve the rest.
+ */
+class QueueSet
+{
+public:
+   /**
+    * QueueSet - constructor
+    * @param sleep_slice_ns - const std::int64_t, longest single
+    *        sleep, bounds the cost of a missed wakeup.
+    * @param spin - const size_t, polling passes before sleeping
+    */
+   QueueSet( const std::int64_t sleep_slice_ns = 1000000,
+             const size_t       spin           = 64 );
+
+   QueueSet( const QueueSet &other ) = delete;
+
+   virtual ~QueueSet();
+
+   /**
+    * add - add a queue to the set.  From here until the set is
+    * destroyed the queue's ends check for sleepers on every
+    * publish.
+    * @param queue    - RingBufferBase&, must outlive the set
+    * @param interest - const Interest, default: Readable
+    * @return size_t  - index reported by wait() for this queue
+    */
+   template < class T, RingBufferType type >
+   size_t add( RingBufferBase< T, type > &queue,
+               const Interest interest = Interest::Readable )
+   {
+      Buffer::Control &control( queue.control() );
+      control.watched.fetch_add( 1, std::memory_order_seq_cst );
+      Entry entry;
+      entry.watched = &control.watched;
+      if( interest == Interest::Readable )
+      {
+         /** 
+          * a closed queue stays ready so the caller sees pop() fail,
+          * and a pending out of band signal is ready for get_signal()
+          * or pop_or_signal(), pop() itself doesn't see it
+          */
+         entry.ready   = [&queue](){ return( queue.size() > 0 ||
+                                             queue.closed()   ||
+                                             queue.signal_pending() ); };
+         entry.epoch   = &control.data_epoch;
+         entry.waiters = &control.data_waiters;
+         entry.stats   = queue.stats_for( Direction::Consumer );
+         entry.shared  = queue.shared_stats_for( Direction::Consumer );
+      }
+      else
+      {
+         entry.ready   = [&queue](){ return( queue.space_avail() > 0 ||
+                                             queue.abandoned() ); };
+         entry.epoch   = &control.space_epoch;
+         entry.waiters = &control.space_waiters;
+         entry.stats   = queue.stats_for( Direction::Producer );
+         entry.shared  = queue.shared_stats_for( Direction::Producer );
+      }
+      entries.push_back( entry );
+      words.push_back( entry.epoch );
+      expected.push_back( 0 );
+      return( entries.size() - 1 );
+   }
+
+   /**
+    * size - number of queues in the set
+    * @return size_t
+    */
+   size_t size() const;
+
+   /**
+    * poll - non-blocking check of every queue.
+    * @param ready   - std::vector< size_t >&, cleared then filled
+    *                  with the indices of ready queues
+    * @return size_t - number of ready queues
+    */
+   size_t poll( std::vector< size_t > &ready );
+
+   /**
+    * wait - block until at least one queue is ready.
+    * @param ready      - std::vector< size_t >&, as with poll
+    * @param timeout_ns - const std::int64_t, < 0 waits forever
+    * @return size_t    - number of ready queues, 0 on timeout
+    */
+   size_t wait( std::vector< size_t > &ready,
+                const std::int64_t timeout_ns = -1 );
+
+   /**
+    * drain - pop up to max_items that are already in the queue
+    * without blocking, calling func( item, signal ) for each.
+    * Meant to be called for each index returned from wait().
+    * @param queue     - RingBufferBase&
+    * @param func      - callable taking ( T&, RBSignal )
+    * @param max_items - const size_t, batch limit per call
+    * @return size_t   - number of items popped
+    */
+   template < class T, RingBufferType type, class F >
+   static size_t drain( RingBufferBase< T, type > &queue,
+                        F func,
+                        const size_t max_items )
+   {
+      const size_t avail( queue.size() );
+      const size_t count( avail < max_items ? avail : max_items );
+      T        item;
+      RBSignal signal( RBSignal::NONE );
+      for( size_t i( 0 ); i < count; i++ )
+      {
+         queue.pop( item, &signal );
+         func( item, signal );
+      }
+      return( count );
+   }
+
+private:
+   struct Entry
+   {
+      std::function< bool () >        ready;
+      std::atomic< std::uint32_t >   *epoch;
+      std::atomic< std::uint32_t >   *waiters;
+      /** the queue's Control::watched, released by the destructor **/
+      std::atomic< std::uint32_t >   *watched;
+      /** the queue's wait counters, nullptr without RB_WAIT_STATS **/
+      WaitStats                      *stats;
+      /** the queue's rbstat counters, nullptr unless published **/
+      QueueStats::End                *shared;
+   };
+
+   /**
+    * charge - add one wait() that found nothing ready to every
+    * queue's counters.
+    */
+   void charge( const std::uint64_t spins,
+                const std::uint64_t sleeps,
+                const std::uint64_t blocked_ns );
+
+   std::vector< Entry >                         entries;
+   /** parallel arrays handed to Futex::waitAny **/
+   std::vector< std::atomic< std::uint32_t >* > words;
+   std::vector< std::uint32_t >                 expected;
+   /** where the next poll starts, for fairness **/
+   size_t                                       cursor;
+   const std::int64_t                           sleep_slice_ns;
+   const size_t                                 spin;
+};
+#endif /* END _QUEUESET_HPP_ */
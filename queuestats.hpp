@@ -0,0 +1,102 @@
+/**
+ * queuestats.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 19:31:08 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _QUEUESTATS_HPP_
+#define _QUEUESTATS_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+/**
+ * QueueStats - what one queue publishes about itself for rbstat,
+ * laid out to sit in its own small SHM segment named
+ * QueueStats::prefix + name.  Each end only writes its own half
+ * (and on its own cache line) so a reader attached read-only
+ * costs the queue nothing but the odd line transfer.  Occupancy
+ * is pushed - popped, rates come from sampling the counters.
+ */
+struct QueueStats
+{
+   /** "RBST", written last by the creator **/
+   static const std::uint32_t magic_value = 0x52425354;
+   static const std::uint32_t version_value = 1;
+   static const size_t        name_length = 64;
+
+   /** SHM key prefix, rbstat finds queues by listing it **/
+   static std::string prefix()
+   {
+      return( "rbstat." );
+   }
+
+   static std::string key( const std::string &name )
+   {
+      return( prefix() + name );
+   }
+
+   /** single writer increment, see WaitStats::add **/
+   static inline void add( std::atomic< std::uint64_t > &counter,
+                           const std::uint64_t n = 1 )
+   {
+      counter.store( counter.load( std::memory_order_relaxed ) + n,
+                     std::memory_order_relaxed );
+   }
+
+   /** one end's counters, producer counts pushes, consumer pops **/
+   struct End
+   {
+      std::atomic< std::uint64_t >  items;
+      /** calls that found the queue full (producer) or empty (consumer) **/
+      std::atomic< std::uint64_t >  waits;
+      std::atomic< std::uint64_t >  blocked_ns;
+      /** 0 until an end attaches, checked with kill( pid, 0 ) **/
+      std::atomic< std::int32_t >   pid;
+      std::atomic< std::uint32_t >  eof;
+   } __attribute__ ((aligned( 64 )));
+
+   /**
+    * init - called by whichever side created the segment, the
+    * memory is already zero.
+    */
+   void init( const std::string &queue_name,
+              const std::uint64_t queue_capacity,
+              const std::uint32_t queue_element_size )
+   {
+      std::strncpy( name, queue_name.c_str(), name_length - 1 );
+      capacity     = queue_capacity;
+      element_size = queue_element_size;
+      version      = version_value;
+      magic.store( magic_value, std::memory_order_release );
+   }
+
+   bool valid() const
+   {
+      return( magic.load( std::memory_order_acquire ) == magic_value &&
+              version == version_value );
+   }
+
+   std::atomic< std::uint32_t >  magic;
+   std::uint32_t                 version;
+   std::uint32_t                 element_size;
+   std::uint64_t                 capacity;
+   char                          name[ name_length ];
+   End                           producer;
+   End                           consumer;
+};
+#endif /* END _QUEUESTATS_HPP_ */
@@ -0,0 +1,339 @@
+/**
+ * rbbench.cpp - parameterized throughput benchmark, sweeps every
+ * combination of the lists given on the command line and writes
+ * one CSV row (or JSON object) per run.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 16:58:12 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "benchmark.tcc"
+#include "SystemClock.tcc"
+
+Clock *system_clock = new SystemClock< TSC >( 0 );
+
+static void
+usage( const char *name )
+{
+   std::cerr << "Usage: " << name << " [options]\n" <<
+   "  -e sizes    element sizes in bytes, default 8\n" <<
+   "              one of 8,16,32,64,128,256,512,1024,4096,16384,65536\n" <<
+   "  -c caps     queue capacities in items, default 1024\n" <<
+   "  -b backs    heap,shm,tcp, default heap\n" <<
+   "  -w waits    spin,yield,block, default spin\n" <<
+   "  -B batches  max items per push / pop wake, default 1\n" <<
+   "  -d defers   ops each end does before publishing its index,\n" <<
+   "              capped at the capacity, default 1 (every op)\n" <<
+   "  -p pairs    producer:consumer cores, e.g. 0:1,0:2, \"auto\" for\n" <<
+   "              the closest cache sharing pair, default unpinned\n" <<
+   "  -n items    items per run, default 10000000\n" <<
+   "  -r runs     repetitions of each point, default 3\n" <<
+   "  -f format   csv or json, default csv\n" <<
+   "  -o file     write results to file, default stdout\n" <<
+   "  -z          zero copy, payloads go in shared slab blocks and\n" <<
+   "              only 8 byte handles are queued, any size >= 8,\n" <<
+   "              heap and shm backings only\n" <<
+   "  -P          add per endpoint hardware counters, per million\n" <<
+   "              items, blank (null) where the counter isn't available\n";
+   exit( EXIT_FAILURE );
+}
+
+/** element size is a template parameter, dispatch on the ones we build **/
+static bool
+run_point( const Bench::Config &config, Bench::Result &result )
+{
+   if( config.zero_copy )
+   {
+      /** only handles are queued, the block size is a runtime value **/
+      if( config.element_size < sizeof( std::uint64_t ) )
+      {
+         return( false );
+      }
+      result = Bench::run_zero_copy( config );
+      return( true );
+   }
+   switch( config.element_size )
+   {
+#define RB_BENCH_SIZE( N ) \
+      case( N ): result = Bench::run_throughput< Bench::Payload< N > >( config ); break;
+      RB_BENCH_SIZE( 8 )
+      RB_BENCH_SIZE( 16 )
+      RB_BENCH_SIZE( 32 )
+      RB_BENCH_SIZE( 64 )
+      RB_BENCH_SIZE( 128 )
+      RB_BENCH_SIZE( 256 )
+      RB_BENCH_SIZE( 512 )
+      RB_BENCH_SIZE( 1024 )
+      RB_BENCH_SIZE( 4096 )
+      RB_BENCH_SIZE( 16384 )
+      RB_BENCH_SIZE( 65536 )
+#undef RB_BENCH_SIZE
+      default:
+         return( false );
+   }
+   return( true );
+}
+
+/** one endpoint's counters scaled to events per million items **/
+static void
+write_counters( std::ostream &out,
+                const char *endpoint,
+                const CounterSample &sample,
+                const std::uint64_t items,
+                const bool json )
+{
+   for( int i( 0 ); i < CounterN; i++ )
+   {
+      if( json )
+      {
+         out << ", \"" << endpoint << "_" <<
+                PerfCounters::getName( (Counter) i ) << "_per_mitem\": ";
+      }
+      else
+      {
+         out << ",";
+      }
+      if( sample.valid[ i ] )
+      {
+         out << ( (double) sample.value[ i ] * 1.0e6 ) / (double) items;
+      }
+      else if( json )
+      {
+         out << "null";
+      }
+   }
+}
+
+int
+main( int argc, char **argv )
+{
+   std::vector< size_t >                  sizes( 1, 8 );
+   std::vector< size_t >                  capacities( 1, 1024 );
+   std::vector< RingBufferType >          backings( 1, RingBufferType::Heap );
+   std::vector< Bench::WaitStrategy >     waits( 1, Bench::WaitStrategy::Spin );
+   std::vector< size_t >                  batches( 1, 1 );
+   std::vector< size_t >                  defers( 1, 1 );
+   std::vector< std::pair< int, int > >   pairs( 1, std::make_pair( -1, -1 ) );
+   size_t                                 items( 10000000 );
+   size_t                                 runs( 3 );
+   bool                                   json( false );
+   bool                                   counters( false );
+   bool                                   zero_copy( false );
+   std::string                            output;
+
+   int opt( -1 );
+   while( ( opt = getopt( argc, argv, "e:c:b:w:B:d:p:n:r:f:o:zPh" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case( 'e' ): sizes      = Bench::split_sizes( optarg ); break;
+         case( 'c' ): capacities = Bench::split_sizes( optarg ); break;
+         case( 'B' ): batches    = Bench::split_sizes( optarg ); break;
+         case( 'd' ): defers     = Bench::split_sizes( optarg ); break;
+         case( 'n' ): items      = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'r' ): runs       = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'b' ):
+         {
+            backings.clear();
+            for( const std::string &name : Bench::split( optarg ) )
+            {
+               RingBufferType backing;
+               if( ! Bench::parse_backing( name, backing ) )
+               {
+                  usage( argv[ 0 ] );
+               }
+               backings.push_back( backing );
+            }
+         }
+         break;
+         case( 'w' ):
+         {
+            waits.clear();
+            for( const std::string &name : Bench::split( optarg ) )
+            {
+               Bench::WaitStrategy wait;
+               if( ! Bench::parse_wait( name, wait ) )
+               {
+                  usage( argv[ 0 ] );
+               }
+               waits.push_back( wait );
+            }
+         }
+         break;
+         case( 'p' ):
+         {
+            if( ! Bench::split_pairs( optarg, pairs ) )
+            {
+               usage( argv[ 0 ] );
+            }
+         }
+         break;
+         case( 'f' ):
+         {
+            const std::string format( optarg );
+            if( format == "json" )      json = true;
+            else if( format == "csv" )  json = false;
+            else usage( argv[ 0 ] );
+         }
+         break;
+         case( 'o' ): output = optarg; break;
+         case( 'z' ): zero_copy = true; break;
+         case( 'P' ): counters = true; break;
+         default:     usage( argv[ 0 ] );
+      }
+   }
+   if( items == 0 || runs == 0 )
+   {
+      usage( argv[ 0 ] );
+   }
+   for( const size_t batch : batches )
+   {
+      if( batch == 0 )
+      {
+         usage( argv[ 0 ] );
+      }
+   }
+
+   std::ofstream ofs;
+   if( output.length() > 0 )
+   {
+      ofs.open( output );
+      if( ! ofs.is_open() )
+      {
+         std::cerr << "Couldn't open \"" << output << "\" for writing!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+   std::ostream &out( output.length() > 0 ? ofs : std::cout );
+
+   if( json )
+   {
+      out << "[\n";
+   }
+   else
+   {
+      out << "backing,element_size,capacity,wait,batch,defer,zero_copy," <<
+             "producer_cpu,consumer_cpu,run,items,seconds,items_per_second," <<
+             "mb_per_second,in_order";
+      if( counters )
+      {
+         for( const char *endpoint : { "producer", "consumer" } )
+         {
+            for( int i( 0 ); i < CounterN; i++ )
+            {
+               out << "," << endpoint << "_" <<
+                      PerfCounters::getName( (Counter) i ) << "_per_mitem";
+            }
+         }
+      }
+      out << "\n";
+   }
+   bool first( true );
+   for( const RingBufferType backing : backings )
+   for( const size_t size : sizes )
+   for( const size_t capacity : capacities )
+   for( const Bench::WaitStrategy wait : waits )
+   for( const size_t batch : batches )
+   for( const size_t defer : defers )
+   for( const auto &pair : pairs )
+   for( size_t run( 0 ); run < runs; run++ )
+   {
+      Bench::Config config;
+      config.backing      = backing;
+      config.element_size = size;
+      config.capacity     = capacity;
+      config.wait         = wait;
+      config.batch        = batch;
+      config.defer        = defer;
+      config.producer_cpu = pair.first;
+      config.consumer_cpu = pair.second;
+      config.items        = items;
+      config.counters     = counters;
+      config.zero_copy    = zero_copy;
+      Bench::Result result;
+      if( ! run_point( config, result ) )
+      {
+         std::cerr << "Unsupported element size (" << size << ")\n";
+         usage( argv[ 0 ] );
+      }
+      const double rate( (double) result.items / result.seconds );
+      const double mb( ( rate * size ) / ( 1 << 20 ) );
+      if( json )
+      {
+         out << ( first ? "" : ",\n" ) <<
+         "  { \"backing\": \""       << Bench::backing_name( backing ) << "\"" <<
+         ", \"element_size\": "      << size <<
+         ", \"capacity\": "          << capacity <<
+         ", \"wait\": \""            << Bench::wait_name( wait ) << "\"" <<
+         ", \"batch\": "             << batch <<
+         ", \"defer\": "             << defer <<
+         ", \"zero_copy\": "         << ( zero_copy ? "true" : "false" ) <<
+         ", \"producer_cpu\": "      << pair.first <<
+         ", \"consumer_cpu\": "      << pair.second <<
+         ", \"run\": "               << run <<
+         ", \"items\": "             << result.items <<
+         ", \"seconds\": "           << result.seconds <<
+         ", \"items_per_second\": "  << rate <<
+         ", \"mb_per_second\": "     << mb <<
+         ", \"in_order\": "          << ( result.in_order ? "true" : "false" );
+         if( counters )
+         {
+            write_counters( out, "producer", result.producer_counters,
+                            result.items, true );
+            write_counters( out, "consumer", result.consumer_counters,
+                            result.items, true );
+         }
+         out << " }";
+      }
+      else
+      {
+         out << Bench::backing_name( backing ) << "," << size << "," <<
+                capacity << "," << Bench::wait_name( wait ) << "," <<
+                batch << "," << defer << "," <<
+                ( zero_copy ? "true" : "false" ) << "," << pair.first << "," <<
+                pair.second << "," <<
+                run << "," << result.items << "," << result.seconds << "," <<
+                rate << "," << mb << "," <<
+                ( result.in_order ? "true" : "false" );
+         if( counters )
+         {
+            write_counters( out, "producer", result.producer_counters,
+                            result.items, false );
+            write_counters( out, "consumer", result.consumer_counters,
+                            result.items, false );
+         }
+         out << "\n";
+      }
+      out.flush();
+      first = false;
+   }
+   if( json )
+   {
+      out << "\n]\n";
+   }
+   delete( system_clock );
+   return( EXIT_SUCCESS );
+}
@@ -0,0 +1,288 @@
+/**
+ * rbheatmap.cpp - runs the queue between every (producer core,
+ * consumer core) pair, measuring throughput and ping-pong round
+ * trip latency for each, annotated with how the two cores are
+ * related (SMT siblings, lowest shared cache, package, NUMA node).
+ * Writes one CSV row per pair and optionally a cpu x cpu matrix
+ * of each measurement for plotting.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 18:12:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "benchmark.tcc"
+#include "SystemClock.tcc"
+#include "histogram.hpp"
+#include "systeminfo.hpp"
+
+Clock *system_clock = new SystemClock< TSC >( 0 );
+
+/** what's measured for one ordered core pair **/
+struct Cell
+{
+   double         items_per_second;
+   std::uint64_t  p50_ns;
+   std::uint64_t  p99_ns;
+   double         mean_ns;
+};
+
+typedef std::map< std::pair< int, int >, Cell > Cells;
+
+static void
+usage( const char *name )
+{
+   std::cerr << "Usage: " << name << " [options]\n" <<
+   "  -C cpus     cpus to pair up, kernel list format (\"0-3,8\"),\n" <<
+   "              default every online cpu\n" <<
+   "  -d          include same core pairs (the diagonal)\n" <<
+   "  -b back     heap, shm or tcp, default heap\n" <<
+   "  -w wait     spin, yield or block, default spin\n" <<
+   "  -c cap      queue capacity in items, default 1024\n" <<
+   "  -n items    throughput items per run, default 1000000\n" <<
+   "  -r runs     throughput runs per pair (median kept), default 3\n" <<
+   "  -i iters    ping-pong round trips per pair, default 10000\n" <<
+   "  -W warmup   ping-pong round trips before recording, default 1000\n" <<
+   "  -o file     write the per pair CSV to file, default stdout\n" <<
+   "  -M prefix   also write prefix.throughput.csv and\n" <<
+   "              prefix.latency.csv cpu x cpu matrices\n";
+   exit( EXIT_FAILURE );
+}
+
+/** traits worth having next to the numbers when comparing machines **/
+static void
+print_traits( std::ostream &out )
+{
+   const Trait traits[] = { ProcessorName,
+                            ProcessorFrequency,
+                            NumberOfProcessors,
+                            LevelOneDCacheSize,
+                            LevelTwoCacheSize,
+                            LevelThreeCacheSize,
+                            LevelOneDCacheLineSize,
+                            MachineName,
+                            OSRelease };
+   for( const Trait trait : traits )
+   {
+      out << "# " << SystemInfo::getName( trait ) << ": " <<
+             SystemInfo::getSystemProperty( trait ) << "\n";
+   }
+   const Topology &topology( SystemInfo::getTopology() );
+   out << "# Topology: " << topology.numNodes() << " node(s), " <<
+          topology.numCPUs() << " cpu(s)\n";
+}
+
+/**
+ * write_matrix - rows are producer (client) cpus, columns consumer
+ * (server) cpus, cells that weren't measured are left empty.
+ */
+static void
+write_matrix( const std::string &filename,
+              const std::vector< int > &cpus,
+              const Cells &cells,
+              const bool throughput )
+{
+   std::ofstream ofs( filename );
+   if( ! ofs.is_open() )
+   {
+      std::cerr << "Couldn't open \"" << filename << "\" for writing!!\n";
+      exit( EXIT_FAILURE );
+   }
+   ofs << ( throughput ? "items_per_second" : "p50_ns" );
+   for( const int cpu : cpus )
+   {
+      ofs << "," << cpu;
+   }
+   ofs << "\n";
+   for( const int producer : cpus )
+   {
+      ofs << producer;
+      for( const int consumer : cpus )
+      {
+         ofs << ",";
+         const auto found( cells.find( std::make_pair( producer, consumer ) ) );
+         if( found != cells.end() )
+         {
+            if( throughput )
+            {
+               ofs << (*found).second.items_per_second;
+            }
+            else
+            {
+               ofs << (*found).second.p50_ns;
+            }
+         }
+      }
+      ofs << "\n";
+   }
+   ofs.close();
+}
+
+int
+main( int argc, char **argv )
+{
+   const Topology &topology( SystemInfo::getTopology() );
+   std::vector< int >   cpus( topology.getCPUs() );
+   bool                 diagonal( false );
+   Bench::Config        config;
+   size_t               runs( 3 );
+   size_t               iterations( 10000 );
+   size_t               warmup( 1000 );
+   std::string          output;
+   std::string          prefix;
+
+   config.items = 1000000;
+
+   int opt( -1 );
+   while( ( opt = getopt( argc, argv, "C:db:w:c:n:r:i:W:o:M:h" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case( 'C' ): cpus            = Topology::parseCPUList( optarg ); break;
+         case( 'd' ): diagonal        = true; break;
+         case( 'c' ): config.capacity = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'n' ): config.items    = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'r' ): runs            = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'i' ): iterations      = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'W' ): warmup          = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'o' ): output          = optarg; break;
+         case( 'M' ): prefix          = optarg; break;
+         case( 'b' ):
+         {
+            if( ! Bench::parse_backing( optarg, config.backing ) )
+            {
+               usage( argv[ 0 ] );
+            }
+         }
+         break;
+         case( 'w' ):
+         {
+            if( ! Bench::parse_wait( optarg, config.wait ) )
+            {
+               usage( argv[ 0 ] );
+            }
+         }
+         break;
+         default:     usage( argv[ 0 ] );
+      }
+   }
+   if( config.items == 0 || config.capacity == 0 || runs == 0 || iterations == 0 )
+   {
+      usage( argv[ 0 ] );
+   }
+
+   std::vector< std::pair< int, int > > pairs;
+   for( const int producer : cpus )
+   {
+      for( const int consumer : cpus )
+      {
+         if( producer != consumer || diagonal )
+         {
+            pairs.push_back( std::make_pair( producer, consumer ) );
+         }
+      }
+   }
+   if( pairs.size() == 0 )
+   {
+      std::cerr << "Need at least two cpus to pair up (or -d), exiting!!\n";
+      exit( EXIT_FAILURE );
+   }
+
+   std::ofstream ofs;
+   if( output.length() > 0 )
+   {
+      ofs.open( output );
+      if( ! ofs.is_open() )
+      {
+         std::cerr << "Couldn't open \"" << output << "\" for writing!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+   std::ostream &out( output.length() > 0 ? ofs : std::cout );
+
+   print_traits( out );
+   out << "# backing: " << Bench::backing_name( config.backing ) <<
+          ", wait: " << Bench::wait_name( config.wait ) <<
+          ", capacity: " << config.capacity << "\n";
+   out << "producer_cpu,consumer_cpu,smt_sibling,shared_cache_level," <<
+          "same_package,producer_node,consumer_node,items_per_second," <<
+          "p50_ns,p99_ns,mean_ns\n";
+
+   typedef Bench::Payload< 8 > Item;
+   /** too big for the stack, reset for every pair **/
+   Histogram *latency( new Histogram() );
+   Cells cells;
+   for( const auto &pair : pairs )
+   {
+      config.producer_cpu = pair.first;
+      config.consumer_cpu = pair.second;
+
+      std::vector< double > rates;
+      for( size_t run( 0 ); run < runs; run++ )
+      {
+         const Bench::Result result( Bench::run_throughput< Item >( config ) );
+         if( ! result.in_order )
+         {
+            std::cerr << "Items out of order between cpu " << pair.first <<
+                         " and cpu " << pair.second << ", exiting!!\n";
+            exit( EXIT_FAILURE );
+         }
+         rates.push_back( (double) result.items / result.seconds );
+      }
+      std::sort( rates.begin(), rates.end() );
+
+      Bench::Config ping( config );
+      ping.items = iterations;
+      latency->reset();
+      Bench::run_pingpong< Item >( ping, warmup, *latency );
+
+      Cell cell;
+      cell.items_per_second = rates[ rates.size() / 2 ];
+      cell.p50_ns           = latency->percentile( 50.0 );
+      cell.p99_ns           = latency->percentile( 99.0 );
+      cell.mean_ns          = latency->mean();
+      cells[ pair ] = cell;
+
+      out << pair.first << "," << pair.second << "," <<
+             ( topology.areSMTSiblings( pair.first, pair.second ) ? "true" : "false" ) << "," <<
+             topology.sharedCacheLevel( pair.first, pair.second ) << "," <<
+             ( topology.samePackage( pair.first, pair.second ) ? "true" : "false" ) << "," <<
+             topology.getNode( pair.first ) << "," <<
+             topology.getNode( pair.second ) << "," <<
+             cell.items_per_second << "," << cell.p50_ns << "," <<
+             cell.p99_ns << "," << cell.mean_ns << "\n";
+      out.flush();
+   }
+   delete( latency );
+
+   if( prefix.length() > 0 )
+   {
+      write_matrix( prefix + ".throughput.csv", cpus, cells, true );
+      write_matrix( prefix + ".latency.csv", cpus, cells, false );
+   }
+   delete( system_clock );
+   return( EXIT_SUCCESS );
+}
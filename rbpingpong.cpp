@@ -0,0 +1,245 @@
+/**
+ * rbpingpong.cpp - round trip latency benchmark, a client sends one
+ * item at a time over a request ring and an echo server sends it
+ * back over a response ring.  Sweeps backings (threads, forked
+ * processes over SHM, loopback TCP) and core pairs, one CSV row
+ * (or JSON object) per point with the latency distribution.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 17:41:05 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "benchmark.tcc"
+#include "SystemClock.tcc"
+#include "histogram.hpp"
+
+Clock *system_clock = new SystemClock< TSC >( 0 );
+
+static void
+usage( const char *name )
+{
+   std::cerr << "Usage: " << name << " [options]\n" <<
+   "  -e sizes    element sizes in bytes, default 8\n" <<
+   "              one of 8,16,32,64,128,256,512,1024,4096\n" <<
+   "  -c caps     queue capacities in items, default 16\n" <<
+   "  -b backs    heap,shm,tcp, default heap,shm,tcp\n" <<
+   "  -w waits    spin,yield,block, default spin\n" <<
+   "  -p pairs    client:server cores, e.g. 0:1,0:2, \"auto\" for\n" <<
+   "              the closest cache sharing pair, default every pair\n" <<
+   "  -n iters    recorded round trips per point, default 100000\n" <<
+   "  -W warmup   round trips before recording, default 1000\n" <<
+   "  -f format   csv or json, default csv\n" <<
+   "  -o file     write results to file, default stdout\n";
+   exit( EXIT_FAILURE );
+}
+
+/** element size is a template parameter, dispatch on the ones we build **/
+static bool
+run_point( const Bench::Config &config,
+           const size_t warmup,
+           Histogram &latency )
+{
+   switch( config.element_size )
+   {
+#define RB_PING_SIZE( N ) \
+      case( N ): Bench::run_pingpong< Bench::Payload< N > >( config, warmup, latency ); break;
+      RB_PING_SIZE( 8 )
+      RB_PING_SIZE( 16 )
+      RB_PING_SIZE( 32 )
+      RB_PING_SIZE( 64 )
+      RB_PING_SIZE( 128 )
+      RB_PING_SIZE( 256 )
+      RB_PING_SIZE( 512 )
+      RB_PING_SIZE( 1024 )
+      RB_PING_SIZE( 4096 )
+#undef RB_PING_SIZE
+      default:
+         return( false );
+   }
+   return( true );
+}
+
+int
+main( int argc, char **argv )
+{
+   std::vector< size_t >                  sizes( 1, 8 );
+   std::vector< size_t >                  capacities( 1, 16 );
+   std::vector< RingBufferType >          backings;
+   std::vector< Bench::WaitStrategy >     waits( 1, Bench::WaitStrategy::Spin );
+   std::vector< std::pair< int, int > >   pairs( Bench::core_pairs() );
+   size_t                                 iterations( 100000 );
+   size_t                                 warmup( 1000 );
+   bool                                   json( false );
+   std::string                            output;
+
+   backings.push_back( RingBufferType::Heap );
+   backings.push_back( RingBufferType::SharedMemory );
+   backings.push_back( RingBufferType::TCP );
+
+   int opt( -1 );
+   while( ( opt = getopt( argc, argv, "e:c:b:w:p:n:W:f:o:h" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case( 'e' ): sizes      = Bench::split_sizes( optarg ); break;
+         case( 'c' ): capacities = Bench::split_sizes( optarg ); break;
+         case( 'n' ): iterations = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'W' ): warmup     = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'b' ):
+         {
+            backings.clear();
+            for( const std::string &name : Bench::split( optarg ) )
+            {
+               RingBufferType backing;
+               if( ! Bench::parse_backing( name, backing ) )
+               {
+                  usage( argv[ 0 ] );
+               }
+               backings.push_back( backing );
+            }
+         }
+         break;
+         case( 'w' ):
+         {
+            waits.clear();
+            for( const std::string &name : Bench::split( optarg ) )
+            {
+               Bench::WaitStrategy wait;
+               if( ! Bench::parse_wait( name, wait ) )
+               {
+                  usage( argv[ 0 ] );
+               }
+               waits.push_back( wait );
+            }
+         }
+         break;
+         case( 'p' ):
+         {
+            if( ! Bench::split_pairs( optarg, pairs ) )
+            {
+               usage( argv[ 0 ] );
+            }
+         }
+         break;
+         case( 'f' ):
+         {
+            const std::string format( optarg );
+            if( format == "json" )      json = true;
+            else if( format == "csv" )  json = false;
+            else usage( argv[ 0 ] );
+         }
+         break;
+         case( 'o' ): output = optarg; break;
+         default:     usage( argv[ 0 ] );
+      }
+   }
+   if( iterations == 0 )
+   {
+      usage( argv[ 0 ] );
+   }
+
+   std::ofstream ofs;
+   if( output.length() > 0 )
+   {
+      ofs.open( output );
+      if( ! ofs.is_open() )
+      {
+         std::cerr << "Couldn't open \"" << output << "\" for writing!!\n";
+         exit( EXIT_FAILURE );
+      }
+   }
+   std::ostream &out( output.length() > 0 ? ofs : std::cout );
+
+   if( json )
+   {
+      out << "[\n";
+   }
+   else
+   {
+      out << "backing,element_size,capacity,wait,client_cpu,server_cpu," <<
+             "iterations,p50_ns,p99_ns,p999_ns,max_ns,mean_ns\n";
+   }
+   /** too big for the stack of every sweep point, reset between them **/
+   Histogram *latency( new Histogram() );
+   bool first( true );
+   for( const RingBufferType backing : backings )
+   for( const size_t size : sizes )
+   for( const size_t capacity : capacities )
+   for( const Bench::WaitStrategy wait : waits )
+   for( const auto &pair : pairs )
+   {
+      Bench::Config config;
+      config.backing      = backing;
+      config.element_size = size;
+      config.capacity     = capacity;
+      config.wait         = wait;
+      config.producer_cpu = pair.first;
+      config.consumer_cpu = pair.second;
+      config.items        = iterations;
+      latency->reset();
+      if( ! run_point( config, warmup, *latency ) )
+      {
+         std::cerr << "Unsupported element size (" << size << ")\n";
+         usage( argv[ 0 ] );
+      }
+      if( json )
+      {
+         out << ( first ? "" : ",\n" ) <<
+         "  { \"backing\": \""       << Bench::backing_name( backing ) << "\"" <<
+         ", \"element_size\": "      << size <<
+         ", \"capacity\": "          << capacity <<
+         ", \"wait\": \""            << Bench::wait_name( wait ) << "\"" <<
+         ", \"client_cpu\": "        << pair.first <<
+         ", \"server_cpu\": "        << pair.second <<
+         ", \"iterations\": "        << latency->count() <<
+         ", \"p50_ns\": "            << latency->percentile( 50.0 ) <<
+         ", \"p99_ns\": "            << latency->percentile( 99.0 ) <<
+         ", \"p999_ns\": "           << latency->percentile( 99.9 ) <<
+         ", \"max_ns\": "            << latency->max() <<
+         ", \"mean_ns\": "           << latency->mean() <<
+         " }";
+      }
+      else
+      {
+         out << Bench::backing_name( backing ) << "," << size << "," <<
+                capacity << "," << Bench::wait_name( wait ) << "," <<
+                pair.first << "," << pair.second << "," <<
+                latency->count() << "," <<
+                latency->percentile( 50.0 ) << "," <<
+                latency->percentile( 99.0 ) << "," <<
+                latency->percentile( 99.9 ) << "," <<
+                latency->max() << "," << latency->mean() << "\n";
+      }
+      out.flush();
+      first = false;
+   }
+   if( json )
+   {
+      out << "\n]\n";
+   }
+   delete( latency );
+   delete( system_clock );
+   return( EXIT_SUCCESS );
+}
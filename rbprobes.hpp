@@ -0,0 +1,122 @@
+/**
+ * rbprobes.hpp - self contained USDT (SystemTap SDT v3) probes,
+ * readable by bpftrace, bcc, perf probe and SystemTap without
+ * sys/sdt.h installed.  Each probe is a single nop in the code
+ * plus an ELF note (.note.stapsdt) recording the nop's address
+ * and where to find the arguments, nothing runs unless a tracer
+ * patches the nop.  List them with "readelf -n <binary>" and
+ * attach with e.g. "bpftrace -e 'usdt:./ringb:ringbuffer:block
+ * { @[arg1] = count(); }'".
+ *
+ * Probes (provider "ringbuffer", arg0 is always the queue's
+ * Buffer::Data pointer so probes from one queue can be matched):
+ *   push        ( queue, index, signal )  item published
+ *   pop         ( queue, index )          item consumed
+ *   recycle     ( queue, count )          items dropped after peek
+ *   eof         ( queue )                 producer closed the queue
+ *   block       ( queue, dir )            end found queue full / empty
+ *   unblock     ( queue, dir )            ... and can carry on again
+ *   wake        ( queue, dir )            futex wake of dir's sleepers
+ *   signal      ( queue, signal )         out of band signal sent
+ *   shm_attach  ( queue, key, dir )       SHM end finished handshaking
+ * dir is the Direction enum value of the end concerned.
+ *
+ * Define RB_NO_PROBES to compile them out entirely, they are
+ * also empty on compilers / targets the asm below doesn't cover.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 20:21:17 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _RBPROBES_HPP_
+#define _RBPROBES_HPP_  1
+#include <type_traits>
+
+#if ! defined RB_NO_PROBES && defined __GNUC__ && defined __ELF__ && \
+   ( defined __x86_64__ || defined __aarch64__ )
+#define RB_PROBES_ENABLED 1
+#endif
+
+#if RB_PROBES_ENABLED
+
+/**
+ * argument spec is "<size>@<operand>", size negative for signed
+ * types.  %n prints the negated constant so the sign is flipped
+ * here, same trick sys/sdt.h uses.
+ */
+template < class T > struct RBProbeArg
+{
+   typedef typename std::decay< T >::type type;
+   static const int spec =
+      ( std::is_signed< type >::value ? 1 : -1 ) * (int) sizeof( type );
+};
+
+#define RB_PROBE_ARG( N, X ) \
+   [_RB_S##N] "n" ( RBProbeArg< decltype( X ) >::spec ), \
+   [_RB_A##N] "nor" ( X )
+
+#define RB_PROBE_NOTE( NAME, ARGS ) \
+   "990: nop\n" \
+   ".pushsection .note.stapsdt,\"?\",\"note\"\n" \
+   ".balign 4\n" \
+   ".4byte 992f-991f, 994f-993f, 3\n" \
+   "991: .asciz \"stapsdt\"\n" \
+   "992: .balign 4\n" \
+   "993: .8byte 990b\n" \
+   ".8byte _.stapsdt.base\n" \
+   ".8byte 0\n" \
+   ".asciz \"ringbuffer\"\n" \
+   ".asciz \"" #NAME "\"\n" \
+   ".asciz \"" ARGS "\"\n" \
+   "994: .balign 4\n" \
+   ".popsection\n" \
+   ".ifndef _.stapsdt.base\n" \
+   ".pushsection .stapsdt.base,\"aGR\",\"progbits\",.stapsdt.base,comdat\n" \
+   ".weak _.stapsdt.base\n" \
+   ".hidden _.stapsdt.base\n" \
+   "_.stapsdt.base: .space 1\n" \
+   ".size _.stapsdt.base, 1\n" \
+   ".popsection\n" \
+   ".endif\n"
+
+#define RB_PROBE_SPEC( N ) "%n[_RB_S" #N "]@%[_RB_A" #N "]"
+
+#define RB_PROBE1( NAME, A1 ) \
+   __asm__ __volatile__( RB_PROBE_NOTE( NAME, RB_PROBE_SPEC( 1 ) ) \
+                         : : RB_PROBE_ARG( 1, A1 ) )
+
+#define RB_PROBE2( NAME, A1, A2 ) \
+   __asm__ __volatile__( RB_PROBE_NOTE( NAME, RB_PROBE_SPEC( 1 ) " " \
+                                              RB_PROBE_SPEC( 2 ) ) \
+                         : : RB_PROBE_ARG( 1, A1 ), \
+                             RB_PROBE_ARG( 2, A2 ) )
+
+#define RB_PROBE3( NAME, A1, A2, A3 ) \
+   __asm__ __volatile__( RB_PROBE_NOTE( NAME, RB_PROBE_SPEC( 1 ) " " \
+                                              RB_PROBE_SPEC( 2 ) " " \
+                                              RB_PROBE_SPEC( 3 ) ) \
+                         : : RB_PROBE_ARG( 1, A1 ), \
+                             RB_PROBE_ARG( 2, A2 ), \
+                             RB_PROBE_ARG( 3, A3 ) )
+
+#else
+
+#define RB_PROBE1( NAME, A1 )
+#define RB_PROBE2( NAME, A1, A2 )
+#define RB_PROBE3( NAME, A1, A2, A3 )
+
+#endif /* END RB_PROBES_ENABLED */
+
+#endif /* END _RBPROBES_HPP_ */
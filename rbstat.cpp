@@ -0,0 +1,281 @@
+/**
+ * rbstat.cpp - top-like live view of every queue that called
+ * publish_stats() on this machine.  Attaches to each queue's
+ * QueueStats segment read only, so it can't disturb a running
+ * pipeline, and shows occupancy, push / pop rates, the share of
+ * time each end spent blocked and whether each end is still alive.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 19:58:40 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <signal.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <sys/mman.h>
+
+#include "shm.hpp"
+#include "queuestats.hpp"
+
+/** counters from the previous refresh, for rates **/
+struct Sample
+{
+   std::uint64_t  pushed;
+   std::uint64_t  popped;
+   std::uint64_t  producer_blocked_ns;
+   std::uint64_t  consumer_blocked_ns;
+   std::chrono::steady_clock::time_point  when;
+};
+
+static void
+usage( const char *name )
+{
+   std::cerr << "Usage: " << name << " [options]\n" <<
+   "  -i ms       refresh interval in milliseconds, default 1000\n" <<
+   "  -n count    number of refreshes, default 0 (until killed)\n" <<
+   "  -m match    only show queues whose name contains match\n" <<
+   "  -x          remove stats segments left behind by queues\n" <<
+   "              whose ends have all exited, then quit\n";
+   exit( EXIT_FAILURE );
+}
+
+/** SHM keys of every published queue, found through /dev/shm **/
+static std::vector< std::string >
+list_queues()
+{
+   std::vector< std::string > keys;
+   DIR *dir( opendir( "/dev/shm" ) );
+   if( dir == nullptr )
+   {
+      perror( "Failed to open /dev/shm" );
+      exit( EXIT_FAILURE );
+   }
+   const std::string prefix( QueueStats::prefix() );
+   struct dirent *entry( nullptr );
+   while( ( entry = readdir( dir ) ) != nullptr )
+   {
+      const std::string name( entry->d_name );
+      if( name.compare( 0, prefix.length(), prefix ) == 0 )
+      {
+         keys.push_back( name );
+      }
+   }
+   closedir( dir );
+   std::sort( keys.begin(), keys.end() );
+   return( keys );
+}
+
+/** -1 never attached, 0 gone, 1 running **/
+static int
+liveness( const std::int32_t pid )
+{
+   if( pid == 0 )
+   {
+      return( -1 );
+   }
+   errno = 0;
+   return( ( kill( pid, 0 ) == 0 || errno == EPERM ) ? 1 : 0 );
+}
+
+static std::string
+end_state( const std::int32_t pid )
+{
+   const int alive( liveness( pid ) );
+   if( alive < 0 )
+   {
+      return( "-" );
+   }
+   return( std::to_string( pid ) + ( alive ? "" : "(dead)" ) );
+}
+
+/**
+ * with_stats - map key read only and hand the stats to func,
+ * quietly skips segments that vanish or aren't ours.
+ */
+template < class F >
+static void
+with_stats( const std::string &key, F func )
+{
+   size_t length( 0 );
+   void *ptr( nullptr );
+   try
+   {
+      ptr = SHM::OpenReadOnly( key.c_str(), length );
+   }
+   catch( bad_shm_alloc &ex )
+   {
+      return;
+   }
+   if( length >= sizeof( QueueStats ) )
+   {
+      const QueueStats *stats( reinterpret_cast< const QueueStats* >( ptr ) );
+      if( stats->valid() )
+      {
+         func( *stats );
+      }
+   }
+   munmap( ptr, length );
+}
+
+static void
+cleanup()
+{
+   for( const std::string &key : list_queues() )
+   {
+      bool stale( false );
+      with_stats( key, [&]( const QueueStats &stats )
+      {
+         stale = ( liveness( stats.producer.pid.load() ) != 1 &&
+                   liveness( stats.consumer.pid.load() ) != 1 );
+      } );
+      if( stale )
+      {
+         if( shm_unlink( key.c_str() ) == 0 )
+         {
+            std::cout << "removed " << key << "\n";
+         }
+         else
+         {
+            perror( ( "Failed to remove " + key ).c_str() );
+         }
+      }
+   }
+}
+
+int
+main( int argc, char **argv )
+{
+   int            interval_ms( 1000 );
+   size_t         count( 0 );
+   std::string    match;
+   bool           clean( false );
+
+   int opt( -1 );
+   while( ( opt = getopt( argc, argv, "i:n:m:xh" ) ) != -1 )
+   {
+      switch( opt )
+      {
+         case( 'i' ): interval_ms = atoi( optarg ); break;
+         case( 'n' ): count       = std::strtoull( optarg, nullptr, 10 ); break;
+         case( 'm' ): match       = optarg; break;
+         case( 'x' ): clean       = true; break;
+         default:     usage( argv[ 0 ] );
+      }
+   }
+   if( interval_ms <= 0 )
+   {
+      usage( argv[ 0 ] );
+   }
+   if( clean )
+   {
+      cleanup();
+      return( EXIT_SUCCESS );
+   }
+
+   const bool tty( isatty( STDOUT_FILENO ) == 1 );
+   std::map< std::string, Sample > previous;
+   for( size_t refresh( 0 ); count == 0 || refresh < count; refresh++ )
+   {
+      if( refresh > 0 )
+      {
+         std::this_thread::sleep_for( std::chrono::milliseconds( interval_ms ) );
+      }
+      if( tty && count != 1 )
+      {
+         /** home and clear, like top **/
+         std::cout << "\033[H\033[2J";
+      }
+      char line[ 256 ];
+      std::snprintf( line, sizeof( line ),
+                     "%-24s %9s %9s %6s %12s %12s %6s %6s %10s %10s %3s\n",
+                     "QUEUE", "CAPACITY", "OCCUPIED", "FILL%", "PUSH/s", "POP/s",
+                     "PBLK%", "CBLK%", "PRODUCER", "CONSUMER", "EOF" );
+      std::cout << line;
+      std::map< std::string, Sample > current;
+      for( const std::string &key : list_queues() )
+      {
+         with_stats( key, [&]( const QueueStats &stats )
+         {
+            const std::string name( stats.name );
+            if( match.length() > 0 && name.find( match ) == std::string::npos )
+            {
+               return;
+            }
+            Sample sample;
+            sample.pushed              = stats.producer.items.load();
+            sample.popped              = stats.consumer.items.load();
+            sample.producer_blocked_ns = stats.producer.blocked_ns.load();
+            sample.consumer_blocked_ns = stats.consumer.blocked_ns.load();
+            sample.when                = std::chrono::steady_clock::now();
+            current[ key ] = sample;
+            /** the two ends race, a pop can land before its push is seen **/
+            const std::uint64_t occupied( sample.pushed > sample.popped ?
+                                          sample.pushed - sample.popped : 0 );
+            char push_rate[ 32 ] = "-", pop_rate[ 32 ] = "-";
+            char producer_blocked[ 16 ] = "-", consumer_blocked[ 16 ] = "-";
+            const auto found( previous.find( key ) );
+            if( found != previous.end() )
+            {
+               const Sample &last( (*found).second );
+               const double ns( (double)
+                  std::chrono::duration_cast< std::chrono::nanoseconds >(
+                     sample.when - last.when ).count() );
+               if( ns > 0 )
+               {
+                  std::snprintf( push_rate, sizeof( push_rate ), "%.0f",
+                     ( sample.pushed - last.pushed ) * 1.0e9 / ns );
+                  std::snprintf( pop_rate, sizeof( pop_rate ), "%.0f",
+                     ( sample.popped - last.popped ) * 1.0e9 / ns );
+                  std::snprintf( producer_blocked, sizeof( producer_blocked ), "%.1f",
+                     ( sample.producer_blocked_ns - last.producer_blocked_ns ) * 100.0 / ns );
+                  std::snprintf( consumer_blocked, sizeof( consumer_blocked ), "%.1f",
+                     ( sample.consumer_blocked_ns - last.consumer_blocked_ns ) * 100.0 / ns );
+               }
+            }
+            std::snprintf( line, sizeof( line ),
+                           "%-24s %9llu %9llu %6.1f %12s %12s %6s %6s %10s %10s %3s\n",
+                           name.c_str(),
+                           (unsigned long long) stats.capacity,
+                           (unsigned long long) occupied,
+                           ( stats.capacity > 0 ?
+                              ( occupied * 100.0 ) / stats.capacity : 0.0 ),
+                           push_rate,
+                           pop_rate,
+                           producer_blocked,
+                           consumer_blocked,
+                           end_state( stats.producer.pid.load() ).c_str(),
+                           end_state( stats.consumer.pid.load() ).c_str(),
+                           ( stats.producer.eof.load() ? "yes" : "no" ) );
+            std::cout << line;
+         } );
+      }
+      std::cout.flush();
+      previous.swap( current );
+   }
+   return( EXIT_SUCCESS );
+}
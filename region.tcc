@@ -0,0 +1,209 @@
+/**
+ * region.tcc -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 09:12:40 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _REGION_TCC_
+#define _REGION_TCC_  1
+#include <cstdlib>
+#include <cstring>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <iostream>
+#include <unistd.h>
+#include "shm.hpp"
+#include "ringbuffertypes.hpp"
+
+namespace Buffer
+{
+
+/**
+ * Region - a single contiguous block of memory that is either
+ * heap allocated or mapped from a named SHM segment.  Used by
+ * the structures that keep all of their state (control words
+ * and slots) in one allocation rather than the separate store,
+ * signal and pointer segments that Data uses.  Memory is always
+ * returned zeroed on the allocating side.
+ */
+template < RingBufferType B > struct Region;
+
+template <> struct Region< RingBufferType::Heap >
+{
+   /**
+    * Region - allocate nbytes aligned to align bytes, exits
+    * on failure just as the heap Data constructor does.
+    * @param   nbytes - const size_t
+    * @param   align  - const size_t, default 64 (cache line)
+    */
+   Region( const size_t nbytes, const size_t align = 64 ) : ptr( nullptr ),
+                                                            length( nbytes ),
+                                                            owner( true )
+   {
+      const int ret_val( posix_memalign( &ptr, align, length ) );
+      if( ret_val != 0 )
+      {
+         std::cerr << "posix_memalign returned error code (" << ret_val << ")";
+         std::cerr << " with message: \n" << strerror( ret_val ) << "\n";
+         exit( EXIT_FAILURE );
+      }
+      std::memset( ptr, 0, length );
+   }
+
+   ~Region()
+   {
+      free( ptr );
+      ptr = nullptr;
+   }
+
+   void          *ptr;
+   const size_t   length;
+   /** heap regions are always created by this side **/
+   const bool     owner;
+};
+
+template <> struct Region< RingBufferType::SharedMemory >
+{
+   /**
+    * Region - the producer side creates the segment with SHM::Init,
+    * the consumer side retries SHM::Open until the producer has
+    * created it (same policy as the SHM Data constructor).
+    * @param   nbytes - const size_t, must match on both sides
+    * @param   key    - const std::string, SHM key
+    * @param   dir    - Direction, Producer creates, Consumer opens
+    */
+   Region( const size_t nbytes,
+           const std::string key,
+           Direction dir ) : ptr( nullptr ),
+                             length( nbytes ),
+                             owner( dir == Direction::Producer ),
+                             key( key ),
+                             fd( -1 )
+   {
+      if( owner )
+      {
+         try
+         {
+            ptr = SHM::Init( key.c_str(), length );
+         }
+         catch( bad_shm_alloc &ex )
+         {
+            std::cerr <<
+               "Bad SHM allocate for key (" <<
+                  key << ") with length (" << length << ")\n";
+            std::cerr << "Message: " << ex.what() << ", exiting.\n";
+            exit( EXIT_FAILURE );
+         }
+      }
+      else
+      {
+         std::string error_copy;
+         const auto deadline( std::chrono::steady_clock::now() +
+                              std::chrono::seconds( 10 ) );
+         while( std::chrono::steady_clock::now() < deadline )
+         {
+            try
+            {
+               ptr = SHM::Open( key.c_str() );
+            }
+            catch( bad_shm_alloc &ex )
+            {
+               error_copy = ex.what();
+               std::this_thread::yield();
+               continue;
+            }
+            break;
+         }
+         if( ptr == nullptr )
+         {
+            std::cerr << "Failed to open shared memory for \"" <<
+               key << "\", exiting!!\n";
+            std::cerr << "Error message: " << error_copy << "\n";
+            exit( EXIT_FAILURE );
+         }
+      }
+      assert( ptr != nullptr );
+   }
+
+   /**
+    * Region - anonymous segment (SHM::InitAnonymous), no name at
+    * all.  fd < 0 creates a new one, zeroed, that this side owns
+    * and hands out through fd.  Otherwise fd (inherited across
+    * fork or from SHM::ReceiveFd) is mapped, it must be at least
+    * nbytes and stays the caller's to close.
+    * @param   nbytes - const size_t
+    * @param   from   - const int, fd to map or < 0 to create
+    */
+   Region( const size_t nbytes,
+           const int from ) : ptr( nullptr ),
+                              length( nbytes ),
+                              owner( from < 0 ),
+                              key(),
+                              fd( -1 )
+   {
+      try
+      {
+         if( owner )
+         {
+            ptr = SHM::InitAnonymous( "ringbuffer", length, fd );
+         }
+         else
+         {
+            size_t mapped( 0 );
+            ptr = SHM::OpenFd( from, mapped );
+            if( mapped < length )
+            {
+               std::cerr << "Anonymous SHM segment is (" << mapped << 
+                  ") bytes, expected (" << length << "), exiting!!\n";
+               exit( EXIT_FAILURE );
+            }
+            /** unmap what OpenFd mapped, not just what we asked for **/
+            length = mapped;
+         }
+      }
+      catch( bad_shm_alloc &ex )
+      {
+         std::cerr << "Bad anonymous SHM allocate with length (" << length << ")\n";
+         std::cerr << "Message: " << ex.what() << ", exiting.\n";
+         exit( EXIT_FAILURE );
+      }
+      assert( ptr != nullptr );
+   }
+
+   ~Region()
+   {
+      SHM::Close( key.c_str(), ptr, length, false, owner && fd < 0 );
+      ptr = nullptr;
+      if( fd >= 0 )
+      {
+         close( fd );
+      }
+   }
+
+   void             *ptr;
+   size_t            length;
+   /** true if this side created (and will unlink) the segment **/
+   const bool        owner;
+   const std::string key;
+   /** anonymous segments only, the creator's memfd, else -1 **/
+   int               fd;
+};
+
+}
+#endif /* END _REGION_TCC_ */
@@ -39,6 +39,8 @@
 #include "ringbufferbase.tcc"
 #include "ringbuffertypes.hpp"
 #include "SystemClock.tcc"
+#include "region.tcc"
+#include "histogram.hpp"
 
 
 /**
@@ -59,17 +61,88 @@ public:
     * RingBuffer - default constructor, initializes basic
     * data structures.
     */
-   RingBuffer( const size_t n ) : RingBufferBase< T, type >()
+   RingBuffer( const size_t n ) : RingBufferBase< T, type >(),
+                                  stamp_region( nullptr ),
+                                  stats_region( nullptr )
    {
       (this)->data = new Buffer::Data<T, type >( n );
    }
 
+   /**
+    * RingBuffer - placement aware constructor.  The store, the
+    * signal array and the pointers with the control block each
+    * get whole pages and, if placement.node is set, are bound to
+    * that node.  Each endpoint thread
+    * calls pin( dir ) to move onto the core picked for it.
+    * @param n         - const size_t, number of items
+    * @param placement - const Placement&, e.g. Placement::Auto()
+    */
+   RingBuffer( const size_t n,
+               const Placement &placement ) : RingBufferBase< T, type >(),
+                                              stamp_region( nullptr ),
+                                              stats_region( nullptr )
+   {
+      (this)->data = new Buffer::Data< T, type >( n, Affinity::pageSize() );
+      (this)->placement = placement;
+      if( placement.node >= 0 )
+      {
+         (this)->data->bind( placement.node );
+      }
+   }
+
    virtual ~RingBuffer()
    {
       delete( (this)->data );
       (this)->data = nullptr;
+      delete( stamp_region );
+      stamp_region = nullptr;
+      (this)->shared_stats = nullptr;
+      delete( stats_region );
+      stats_region = nullptr;
+   }
+
+   /**
+    * publish_stats - opt in to publishing this queue's counters
+    * (occupancy, items pushed and popped, blocked time, pids) to
+    * a SHM segment keyed QueueStats::key( name ) where rbstat can
+    * find them.  The segment goes away with the queue.  Call
+    * before either end starts using the queue.
+    * @param name - const std::string&, unique on this machine
+    */
+   void publish_stats( const std::string &name )
+   {
+      assert( stats_region == nullptr );
+      stats_region = new Buffer::Region< RingBufferType::SharedMemory >(
+         sizeof( QueueStats ),
+         QueueStats::key( name ),
+         Direction::Producer );
+      QueueStats *stats( reinterpret_cast< QueueStats* >( stats_region->ptr ) );
+      stats->init( name, (this)->data->max_cap, sizeof( T ) );
+      (this)->enable_stats( stats, true, true );
    }
 
+   /**
+    * trace - opt in to latency tracing.  One item in every is
+    * stamped with system_clock at push and its push to pop
+    * latency in nanoseconds is recorded into latency at pop.
+    * Call before either end starts using the queue.
+    * @param latency - Histogram*, must outlive the queue
+    * @param every   - const size_t, default every item
+    */
+   void trace( Histogram *latency, const size_t every = 1 )
+   {
+      assert( stamp_region == nullptr );
+      assert( latency != nullptr );
+      stamp_region = new Buffer::Region< RingBufferType::Heap >(
+         sizeof( std::uint64_t ) * (this)->data->max_cap );
+      (this)->enable_trace( reinterpret_cast< std::uint64_t* >( stamp_region->ptr ),
+                            latency,
+                            every );
+   }
+
+protected:
+   Buffer::Region< RingBufferType::Heap >          *stamp_region;
+   Buffer::Region< RingBufferType::SharedMemory >  *stats_region;
 };
 
 
@@ -93,22 +166,162 @@ public:
                Direction         dir,
                const size_t      alignment = 16 ) : 
                RingBufferBase< T, RingBufferType::SharedMemory >(),
-                                              shm_key( key )
+                                              shm_key( key ),
+                                              direction( dir ),
+                                              stamp_region( nullptr ),
+                                              stats_region( nullptr )
+   {
+      (this)->data = 
+         new Buffer::Data< T, 
+                           RingBufferType::SharedMemory >( nitems, key, dir, alignment );
+      assert( (this)->data != nullptr );
+   }
+
+   /**
+    * RingBuffer - anonymous SHM queue on a memfd, no name and no
+    * /dev/shm entry.  One end passes fd < 0 to create it, which
+    * never waits for the other end, and hands fd() to the other
+    * end: a forked child can use the inherited descriptor as is,
+    * an unrelated process gets it with SHM::SendFd / ReceiveFd.
+    * Both ends pass the same nitems.
+    * @param nitems - const size_t
+    * @param fd     - const int, < 0 creates, else the creator's fd()
+    * @param dir    - Direction
+    */
+   RingBuffer( const size_t      nitems,
+               const int         fd,
+               Direction         dir ) : 
+               RingBufferBase< T, RingBufferType::SharedMemory >(),
+                                              shm_key(),
+                                              direction( dir ),
+                                              stamp_region( nullptr ),
+                                              stats_region( nullptr )
+   {
+      (this)->data = 
+         new Buffer::Data< T, RingBufferType::SharedMemory >( nitems, fd, dir );
+      assert( (this)->data != nullptr );
+   }
+
+   /**
+    * RingBuffer - placement aware SHM constructor, the producer
+    * side (which created and zeroed the segments) binds them to
+    * placement.node, both sides may pin( dir ) afterwards.
+    * @param nitems    - const size_t
+    * @param key       - const std::string, same for both ends
+    * @param dir       - Direction
+    * @param placement - const Placement&
+    * @param alignment - const size_t
+    */
+   RingBuffer( const size_t      nitems,
+               const std::string key,
+               Direction         dir,
+               const Placement   &placement,
+               const size_t      alignment = 16 ) : 
+               RingBufferBase< T, RingBufferType::SharedMemory >(),
+                                              shm_key( key ),
+                                              direction( dir ),
+                                              stamp_region( nullptr ),
+                                              stats_region( nullptr )
    {
       (this)->data = 
          new Buffer::Data< T, 
                            RingBufferType::SharedMemory >( nitems, key, dir, alignment );
       assert( (this)->data != nullptr );
+      (this)->placement = placement;
+      if( dir == Direction::Producer && placement.node >= 0 )
+      {
+         (this)->data->bind( placement.node );
+      }
    }
 
    virtual ~RingBuffer()
    {
+      /** let the other process know this end is gone **/
+      if( direction == Direction::Producer )
+      {
+         (this)->close();
+      }
+      else
+      {
+         (this)->abandon();
+      }
       delete( (this)->data );      
       (this)->data = nullptr;
+      delete( stamp_region );
+      stamp_region = nullptr;
+      (this)->shared_stats = nullptr;
+      delete( stats_region );
+      stats_region = nullptr;
+   }
+
+   /**
+    * publish_stats - opt in to publishing this queue's counters
+    * for rbstat, both ends call it with the same name.  The
+    * producer creates the QueueStats::key( name ) segment and
+    * removes it again on destruction, each end only writes its
+    * own counters.
+    * @param name - const std::string&, unique on this machine
+    */
+   void publish_stats( const std::string &name )
+   {
+      assert( stats_region == nullptr );
+      stats_region = new Buffer::Region< RingBufferType::SharedMemory >(
+         sizeof( QueueStats ),
+         QueueStats::key( name ),
+         direction );
+      QueueStats *stats( reinterpret_cast< QueueStats* >( stats_region->ptr ) );
+      if( direction == Direction::Producer )
+      {
+         stats->init( name, (this)->data->max_cap, sizeof( T ) );
+      }
+      (this)->enable_stats( stats,
+                            direction == Direction::Producer,
+                            direction == Direction::Consumer );
+   }
+
+   /**
+    * fd - the memfd to hand the other end of an anonymous queue,
+    * -1 for keyed queues and on the end that was handed it.
+    * @return int
+    */
+   int fd() const
+   {
+      return( (this)->data->region != nullptr ? (this)->data->region->fd : -1 );
+   }
+
+   /**
+    * trace - opt in to latency tracing, both ends must call it
+    * with the same every right after construction.  The stamps
+    * live in their own segment ( key + "_trace" ), or in the
+    * queue's own segment if it is anonymous, and are taken
+    * with system_clock, so both processes need the same timebase,
+    * e.g. a shared SystemClock< TSC >.
+    * @param latency - Histogram*, consumer's histogram, nullptr
+    *                  on the producer side
+    * @param every   - const size_t, default every item
+    */
+   void trace( Histogram *latency, const size_t every = 1 )
+   {
+      assert( stamp_region == nullptr );
+      if( (this)->data->stamps != nullptr )
+      {
+         (this)->enable_trace( (this)->data->stamps, latency, every );
+         return;
+      }
+      stamp_region = new Buffer::Region< RingBufferType::SharedMemory >(
+         sizeof( std::uint64_t ) * (this)->data->max_cap,
+         shm_key + "_trace",
+         direction );
+      (this)->enable_trace( reinterpret_cast< std::uint64_t* >( stamp_region->ptr ),
+                            latency,
+                            every );
    }
 
 protected:
    const  std::string shm_key;
+   const  Direction   direction;
+   Buffer::Region< RingBufferType::SharedMemory >  *stamp_region;
+   Buffer::Region< RingBufferType::SharedMemory >  *stats_region;
 };
 
 
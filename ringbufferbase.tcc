@@ -21,25 +21,27 @@
 #define _RINGBUFFERBASE_TCC_  1
 
 #include <array>
+#include <iterator>
 #include <cstdlib>
 #include <cassert>
 #include <thread>
 #include <cstring>
 #include <iostream>
+#include <unistd.h>
 #include "Clock.hpp"
+#include "futex.hpp"
 #include "pointer.hpp"
 #include "ringbuffertypes.hpp"
 #include "bufferdata.tcc"
 #include "signalvars.hpp"
 #include "blocked.hpp"
-
-/**
- * Note: there is a NICE define that can be uncommented
- * below if you want sched_yield called when waiting for
- * writes or blocking for space, otherwise blocking will
- * actively spin while waiting.
- */
-#define NICE 1
+#include "affinity.hpp"
+#include "histogram.hpp"
+#include "waitstats.hpp"
+#include "queuestats.hpp"
+#include "rbprobes.hpp"
+/** NICE lives in here **/
+#include "spinwait.hpp"
 
 extern Clock *system_clock;
 
@@ -53,7 +55,21 @@ public:
     */
    RingBufferBase() : data( nullptr ),
                       allocate_called( false ),
-                      write_finished( false )
+                      stamps( nullptr ),
+                      latency( nullptr ),
+                      trace_every( 1 ),
+                      push_countdown( 1 ),
+                      pop_countdown( 1 ),
+                      shared_stats( nullptr ),
+                      publish_batch( 0 ),
+                      publish_timeout( 0 ),
+                      write_pending( 0 ),
+                      read_pending( 0 ),
+                      write_oldest( 0 ),
+                      read_oldest( 0 )
+#ifdef RB_META_SEQUENCE
+                      , push_sequence( 0 )
+#endif
    {
    }
    
@@ -64,60 +80,26 @@ public:
 
    /**
     * size - as you'd expect it returns the number of 
-    * items currently in the queue.
+    * items currently in the queue.  With deferred publication
+    * on this is the calling consumer's view, items it has
+    * already read but not yet published are not counted.
     * @return size_t
     */
    size_t   size()
    {
-      const auto   wrap_write( Pointer::wrapIndicator( data->write_pt  ) ),
-                   wrap_read(  Pointer::wrapIndicator( data->read_pt   ) );
-
-      const auto   wpt( Pointer::val( data->write_pt ) ), 
-                   rpt( Pointer::val( data->read_pt  ) );
-      if( wpt == rpt )
-      {
-         if( wrap_read < wrap_write )
-         {
-            return( data->max_cap );
-         }
-         else if( wrap_read > wrap_write )
-         {
-            /**
-             * TODO, this condition is momentary, however there
-             * is a better way to fix this with atomic operations...
-             * or on second thought benchmarking shows the atomic
-             * operations slows the queue down drastically so, perhaps
-             * this is in fact the best of all possible returns.
-             */
-            return( data->max_cap  );
-         }
-         else
-         {
-            return( 0 );
-         }
-      }
-      else if( rpt < wpt )
-      {
-         return( wpt - rpt );
-      }
-      else if( rpt > wpt )
-      {
-         return( data->max_cap - rpt + wpt ); 
-      }
-      return( 0 );
+      return( published_size() - read_pending );
    }
 
-   
-
    /**
     * space_avail - returns the amount of space currently
     * available in the queue.  This is the amount a user
-    * can expect to write without blocking
+    * can expect to write without blocking, from the calling
+    * producer's view when deferred publication is on.
     * @return  size_t
     */
     size_t   space_avail()
    {
-      return( data->max_cap - size() );
+      return( data->max_cap - published_size() - write_pending );
    }
   
    /**
@@ -130,31 +112,28 @@ public:
       return( data->max_cap );
    }
 
+   /**
+    * control - shared control words for this queue, used by
+    * QueueSet to sleep until data or space shows up.
+    * @return Buffer::Control&
+    */
+   Buffer::Control& control()
+   {
+      return( *(data->control) );
+   }
+
    /**
     * allocate - get a reference to an object of type T at the 
     * end of the queue.  Should be released to the queue using
     * the push command once the calling thread is done with the 
-    * memory.
+    * memory.  If the consumer has abandoned the queue the
+    * reference is still valid but the following push() drops it.
     * @return T&, reference to memory location at head of queue
     */
    T& allocate()
    {
-      while( space_avail() == 0 )
-      {
-#ifdef NICE      
-         std::this_thread::yield();
-#endif         
-#if __x86_64
-         __asm__ volatile("\
-           pause"
-           :
-           :
-           : );
-#endif           
-      }
-      (this)->allocate_called = true;
-      const size_t write_index( Pointer::val( data->write_pt ) );
-      return( data->store[ write_index ].item );
+      (this)->allocate_called = wait_for_space( 1 );
+      return( data->store[ write_slot() ].item );
    }
 
    /**
@@ -162,50 +141,48 @@ public:
     * the queue.  Function will imply return if allocate wasn't
     * called prior to calling this function.
     * @param signal - const RBSignal signal, default: NONE
+    * @return bool - false if nothing was allocated or the
+    *                consumer abandoned the queue
     */
-   void push( const RBSignal signal = RBSignal::NONE )
+   bool push( const RBSignal signal = RBSignal::NONE )
    {
-      if( ! (this)->allocate_called ) return;
-      const size_t write_index( Pointer::val( data->write_pt ) );
-      data->signal[ write_index ].sig = signal;
-      Pointer::inc( data->write_pt );
-      if( signal == RBSignal::RBEOF )
-      {
-         (this)->write_finished = true;
-      }
-      (this)->allocate_called = false;
+      return( push_allocated( signal, nullptr ) );
    }
 
    /**
     * push- writes a single item to the queue, blocks
-    * until there is enough space.
+    * until there is enough space.  Pushing RBEOF also close()s
+    * the queue.
     * @param   item, T
+    * @return  bool - false if the consumer abandoned the queue,
+    *                 the item is dropped
     */
-   void  push( T &item, const RBSignal signal = RBSignal::NONE )
+   bool  push( T &item, const RBSignal signal = RBSignal::NONE )
    {
-      while( space_avail() == 0 )
-      {
-#ifdef NICE      
-         std::this_thread::yield();
-#endif         
-#if __x86_64
-         __asm__ volatile("\
-           pause"
-           :
-           :
-           : );
-#endif           
-      }
-      
-	   const size_t write_index( Pointer::val( data->write_pt ) );
-	   data->store[ write_index ].item     = item;
-	   data->signal[ write_index ].sig   = signal;
-	   Pointer::inc( data->write_pt );
-      if( signal == RBSignal::RBEOF )
-      {
-         (this)->write_finished = true;
-      }
+      return( push_item( item, signal, nullptr ) );
+   }
+
+#if RB_META_ENABLED
+   /**
+    * push - as above, with the user fields of the item's SlotMeta
+    * (tag and flags, if compiled in) taken from meta.  The queue
+    * fills in sequence and timestamp itself.
+    * @param meta   - const SlotMeta&
+    * @param signal - const RBSignal, default: NONE
+    * @return bool
+    */
+   bool push( const SlotMeta &meta, const RBSignal signal = RBSignal::NONE )
+   {
+      return( push_allocated( signal, &meta ) );
    }
+
+   bool push( T &item,
+              const SlotMeta &meta,
+              const RBSignal signal = RBSignal::NONE )
+   {
+      return( push_item( item, signal, &meta ) );
+   }
+#endif
    
    /**
     * insert - inserts the range from begin to end in the queue,
@@ -216,72 +193,98 @@ public:
     * be room.
     * @param   begin - iterator_type, iterator to begin of range
     * @param   end   - iterator_type, iterator to end of range
+    * @return  bool  - false if the consumer abandoned the queue
+    *                  part way, the rest of the range is dropped
     */
    template< class iterator_type >
-   void insert(   iterator_type begin, 
+   bool insert(   iterator_type begin, 
                   iterator_type end, 
                   const RBSignal signal = RBSignal::NONE )
    {
+      size_t count( 0 );
       while( begin != end )
       {
-         while( space_avail() == 0 )
+         if( ! wait_for_space( 1 ) )
          {
-#ifdef NICE
-            std::this_thread::yield();
-#endif
+            count_push( count );
+            return( false );
          }
-         const size_t write_index( Pointer::val( data->write_pt ) );
+         const size_t write_index( write_slot() );
          data->store[ write_index ].item = (*begin);
          
          /** add signal to last el only **/
-         if( begin == ( end - 1 ) )
-         {
-            data->signal[ write_index ].sig = signal;
-         }
-         else
-         {
-            data->signal[ write_index ].sig = RBSignal::NONE;
-         }
-         Pointer::inc( data->write_pt );
+         const RBSignal item_signal( begin == ( end - 1 ) ? signal :
+                                                            RBSignal::NONE );
+         data->signal[ write_index ].sig = item_signal;
+         stamp_meta( write_index, nullptr );
+         trace_push( write_index );
+         RB_PROBE3( push, data, write_index, item_signal );
+         wrote( item_signal );
          begin++;
+         count++;
       }
+      count_push( count );
       if( signal == RBSignal::RBEOF )
       {
-         (this)->write_finished = true;
+         close();
       }
+      return( true );
    }
 
   
    /**
     * pop - read one item from the ring buffer,
-    * will block till there is data to be read
-    * @return  T, item read.  It is removed from the
-    *          q as soon as it is read
+    * will block till there is data to be read or the producer
+    * has closed the queue and everything in it has been read.
+    * End of stream only needs the return value, leave signal
+    * nullptr unless the per item signals are wanted.
+    * @param   item   - T&, item read, untouched on false.  It is
+    *                   removed from the q as soon as it is read
+    * @param   signal - RBSignal*, default nullptr
+    * @return  bool   - false once the queue is drained, only
     */
-   void 
+   bool 
    pop( T &item, RBSignal *signal = nullptr )
    {
-      while( size() == 0 )
-      {
-#ifdef NICE      
-         std::this_thread::yield();
-#endif        
-#if __x86_64
-         __asm__ volatile("\
-           pause"
-           :
-           :
-           : );
-#endif           
-      }
-      const size_t read_index( Pointer::val( data->read_pt ) );
-      if( signal != nullptr )
+      return( pop_item( item, signal, nullptr, false ) );
+   }
+
+   /**
+    * pop_or_signal - pop() for a consumer that also takes out of
+    * band signals, blocks until there is an item, the queue is
+    * drained or a signal arrives.  A pending signal goes ahead of
+    * anything queued.
+    * @param   item   - T&, untouched on false
+    * @param   signal - RBSignal&, the item's signal on true, on
+    *                   false the out of band signal taken or
+    *                   RBEOF once drained
+    * @return  bool   - true if item was popped
+    */
+   bool
+   pop_or_signal( T &item, RBSignal &signal )
+   {
+      if( ! signal_pending() && pop_item( item, &signal, nullptr, true ) )
       {
-         *signal = data->signal[ read_index ].sig;
+         return( true );
       }
-      item = data->store[ read_index ].item;
-      Pointer::inc( data->read_pt );
+      signal = ( signal_pending() ? get_signal() : RBSignal::RBEOF );
+      return( false );
+   }
+
+#if RB_META_ENABLED
+   /**
+    * pop - as above, also copying out the item's SlotMeta.
+    * @param   item   - T&
+    * @param   meta   - SlotMeta&, untouched on false
+    * @param   signal - RBSignal*, default nullptr
+    * @return  bool
+    */
+   bool
+   pop( T &item, SlotMeta &meta, RBSignal *signal = nullptr )
+   {
+      return( pop_item( item, signal, &meta, false ) );
    }
+#endif
 
    /**
     * pop_range - pops a range and returns it as a std::array.  The
@@ -289,27 +292,30 @@ public:
     * the static std::array was chosen as its a bit faster, however 
     * this might change in future implementations to a std::vector
     * or some other structure.
+    * @return bool - false, with nothing popped, if the producer
+    *                closed with fewer than N items left, pop()
+    *                the remainder
     */
    template< size_t N >
-   void  pop_range( std::array< T, N > &output, 
+   bool  pop_range( std::array< T, N > &output, 
                     std::array< RBSignal, N > *signal = nullptr )
    {
-      while( size() < N )
+      if( ! wait_for_data( N ) )
       {
-#ifdef NICE
-         std::this_thread::yield();
-#endif
+         return( false );
       }
      
+      const size_t first( read_slot() );
       size_t read_index;
       if( signal != nullptr )
       {
          for( size_t i( 0 ); i < N; i++ )
          {
-            read_index( Pointer::val( data->read_pt ) );
+            read_index = ( first + i ) % data->max_cap;
             output[ i ]       = data->store[ read_index ].item;
             (*signal)[ i ]    = data->signal[ read_index ].sig;
-            Pointer::inc( data->read_pt );
+            trace_pop( read_index );
+            RB_PROBE2( pop, data, read_index );
          }
       }
       else /** ignore signal **/
@@ -317,13 +323,16 @@ public:
          /** TODO, incorporate streaming copy here **/
          for( size_t i( 0 ); i < N; i++ )
          {
-            read_index( Pointer::val( data->read_pt ) );
+            read_index = ( first + i ) % data->max_cap;
             output[ i ]    = data->store[ read_index ].item;
-            Pointer::inc( data->read_pt );
+            trace_pop( read_index );
+            RB_PROBE2( pop, data, read_index );
          }
 
       }
-      return;
+      consumed( N );
+      count_pop( N );
+      return( true );
    }
 
 
@@ -331,28 +340,20 @@ public:
     * peek() - look at a reference to the head of the
     * ring buffer.  This doesn't remove the item, but it 
     * does give the user a chance to take a look at it without
-    * removing.
+    * removing.  If the queue is drained there is nothing to
+    * look at, it returns the stale head slot straight away and
+    * sets signal to RBEOF, check drained() first if no signal
+    * is passed.  Out of band signals don't wake it.
     * @return T&
     */
     T& peek(  RBSignal *signal = nullptr )
    {
-      while( size() < 1 )
-      {
-#ifdef NICE      
-         std::this_thread::yield();
-#endif     
-#if  __x86_64   
-         __asm__ volatile("\
-           pause"
-           :
-           :
-           : );
-#endif
-      }
-      const size_t read_index( Pointer::val( data->read_pt ) );
+      const bool ready( wait_for_data( 1 ) );
+      const size_t read_index( read_slot() );
       if( signal != nullptr )
       {
-         *signal = data->signal[ read_index ].sig;
+         *signal = ( ready ? data->signal[ read_index ].sig :
+                             RBSignal::RBEOF );
       }
       T &output( data->store[ read_index ].item );
       return( output );
@@ -367,10 +368,711 @@ public:
    void recycle( const size_t range = 1 )
    {
       assert( range <= data->max_cap );
-      Pointer::incBy( range, data->read_pt );
+      if( stamps != nullptr )
+      {
+         const size_t first( read_slot() );
+         for( size_t i( 0 ); i < range; i++ )
+         {
+            trace_pop( ( first + i ) % data->max_cap );
+         }
+      }
+      RB_PROBE2( recycle, data, range );
+      consumed( range );
+      count_pop( range );
+   }
+
+   /**
+    * defer_publication - opt in to publishing the read and write
+    * indices in batches.  Each end keeps up to batch operations
+    * to itself before moving the shared index, cutting the shared
+    * line writes (and the other end's misses) by up to batch times
+    * for a bounded delay.  An end publishes early when it pushes
+    * a signal (RBEOF included), before it waits on a full / empty
+    * queue, when the other end looks starved (nothing published
+    * to read, or no published space), when it has drained or
+    * filled everything it can see, on flush(), and, if timeout_ns
+    * is set, at the first operation after its oldest unpublished
+    * one turned timeout_ns old.  Nothing publishes from a thread
+    * that has gone idle, call flush( dir ) before idling without
+    * an RBEOF.  For SHM queues each end sets its own.  Call before
+    * the queue is in use.
+    * @param batch      - const size_t, 0 or 1 publishes every op
+    * @param timeout_ns - const std::uint64_t, 0 for no timeout
+    */
+   void defer_publication( const size_t batch,
+                           const std::uint64_t timeout_ns = 0 )
+   {
+      assert( batch <= data->max_cap );
+      (this)->publish_batch   = batch;
+      (this)->publish_timeout = timeout_ns;
+   }
+
+   /**
+    * flush - publish the given end's unpublished operations now,
+    * only call it from that end's thread.
+    * @param dir - const Direction
+    */
+   void flush( const Direction dir )
+   {
+      if( dir == Direction::Producer )
+      {
+         flush_writes();
+      }
+      else
+      {
+         flush_reads();
+      }
+   }
+
+   /**
+    * close - producer's end of stream.  Publishes anything still
+    * pending and marks the queue closed in its shared control
+    * block, the consumer drains what is left and pop() then
+    * returns false.  Pushing RBEOF closes, so does destroying an
+    * SHM producer end.  Only the first call does anything.
+    */
+   void close()
+   {
+      flush_writes();
+      if( data->control->closed.exchange( 1, std::memory_order_release ) != 0 )
+      {
+         return;
+      }
+      RB_PROBE1( eof, data );
+      if( shared_stats != nullptr )
+      {
+         shared_stats->producer.eof.store( 1, std::memory_order_relaxed );
+      }
+      notify_data();
+   }
+
+   /**
+    * abandon - consumer's end of stream, nothing more will be
+    * read.  Pushes blocked on a full queue, and any after it,
+    * return false rather than wait.  Destroying an SHM consumer
+    * end abandons.
+    */
+   void abandon()
+   {
+      flush_reads();
+      data->control->abandoned.store( 1, std::memory_order_release );
+      notify_space();
+   }
+
+   /**
+    * closed - true once the producer has closed, there may still
+    * be items to pop.
+    * @return bool
+    */
+   bool closed() const
+   {
+      return( data->control->closed.load( std::memory_order_acquire ) != 0 );
+   }
+
+   /**
+    * drained - closed and nothing left to pop, what pop()
+    * returning false means.
+    * @return bool
+    */
+   bool drained()
+   {
+      /** closed first, close() publishes the last write before it **/
+      return( closed() && size() == 0 );
+   }
+
+   /**
+    * abandoned - true once the consumer has given up on the queue.
+    * @return bool
+    */
+   bool abandoned() const
+   {
+      return( data->control->abandoned.load( std::memory_order_acquire ) != 0 );
+   }
+
+   /**
+    * send_signal - out of band signal to the consumer (QUIT, TERM,
+    * ...), it goes through the queue's control block instead of
+    * behind whatever items are queued, and wakes the consumer if
+    * it is blocked in pop_or_signal() or a QueueSet.  Up to Buffer::Control::signal_slots can be
+    * waiting, call from one thread at a time.
+    * @param signal - const RBSignal&
+    * @return bool - false if the consumer has that many unread
+    */
+   bool send_signal( const RBSignal &signal )
+   {
+      if( ! data->control->push_signal( signal ) )
+      {
+         return( false );
+      }
+      RB_PROBE2( signal, data, signal );
+      notify_data();
+      return( true );
+   }
+
+   /**
+    * get_signal - consumer side, takes the oldest out of band
+    * signal.  These take priority over the queue's contents, a
+    * consumer working through a backlog should check between
+    * items.  pop() never sees them, a consumer that wants to be
+    * woken by one blocks in pop_or_signal() instead.
+    * @return RBSignal - NONE if nothing was sent
+    */
+   RBSignal get_signal()
+   {
+      return( data->control->pop_signal() );
+   }
+
+   /**
+    * signal_pending - true if get_signal() has something to
+    * return, doesn't take it.
+    * @return bool
+    */
+   bool signal_pending() const
+   {
+      return( data->control->signal_pending() );
+   }
+
+   /**
+    * pin - pin the calling thread to the cpu this queue's
+    * Placement picked for the given end, call it from the
+    * producer and consumer threads themselves.  Does nothing
+    * unless the queue was constructed with pinning asked for.
+    * @param dir - const Direction, which end the caller is
+    * @return bool - true if the thread was pinned
+    */
+   bool pin( const Direction dir )
+   {
+      if( ! placement.pin )
+      {
+         return( false );
+      }
+      const int cpu( dir == Direction::Producer ? placement.producer_cpu :
+                                                  placement.consumer_cpu );
+      if( cpu < 0 )
+      {
+         return( false );
+      }
+      return( Affinity::pin( cpu ) );
+   }
+
+   /**
+    * wait_stats - how long and how often the given end has had
+    * to wait on this queue, producer for space and consumer for
+    * data.  Only the calling process's endpoint is counted, all
+    * zero unless built with -DRB_WAIT_STATS.
+    * @param dir - const Direction
+    * @return WaitCounts
+    */
+   WaitCounts wait_stats( const Direction dir ) const
+   {
+#ifdef RB_WAIT_STATS
+      return( dir == Direction::Producer ? full_stats.read() :
+                                           empty_stats.read() );
+#else
+      return( WaitCounts() );
+#endif
+   }
+
+   /**
+    * stats_for - live counters for one end, nullptr unless built
+    * with -DRB_WAIT_STATS.  QueueSet charges its waits here.
+    * @param dir - const Direction
+    * @return WaitStats*
+    */
+   WaitStats* stats_for( const Direction dir )
+   {
+#ifdef RB_WAIT_STATS
+      return( dir == Direction::Producer ? &full_stats : &empty_stats );
+#else
+      return( nullptr );
+#endif
+   }
+
+   /**
+    * shared_stats_for - one end's published rbstat counters,
+    * nullptr unless publish_stats() was called.  QueueSet adds
+    * its blocked time here.
+    * @param dir - const Direction
+    * @return QueueStats::End*
+    */
+   QueueStats::End* shared_stats_for( const Direction dir )
+   {
+      if( shared_stats == nullptr )
+      {
+         return( nullptr );
+      }
+      return( dir == Direction::Producer ? &shared_stats->producer :
+                                           &shared_stats->consumer );
    }
 
 protected:
+   /** body of the push() overloads that follow an allocate() **/
+   inline bool push_allocated( const RBSignal signal, const SlotMeta *meta )
+   {
+      if( ! (this)->allocate_called ) return( false );
+      const size_t write_index( write_slot() );
+      data->signal[ write_index ].sig = signal;
+      stamp_meta( write_index, meta );
+      trace_push( write_index );
+      RB_PROBE3( push, data, write_index, signal );
+      wrote( signal );
+      count_push( 1 );
+      if( signal == RBSignal::RBEOF )
+      {
+         close();
+      }
+      (this)->allocate_called = false;
+      return( true );
+   }
+
+   /** body of the push() overloads that take an item **/
+   inline bool push_item( T &item,
+                          const RBSignal signal,
+                          const SlotMeta *meta )
+   {
+      if( ! wait_for_space( 1 ) )
+      {
+         return( false );
+      }
+      
+	   const size_t write_index( write_slot() );
+	   data->store[ write_index ].item     = item;
+	   data->signal[ write_index ].sig   = signal;
+      stamp_meta( write_index, meta );
+      trace_push( write_index );
+      RB_PROBE3( push, data, write_index, signal );
+      wrote( signal );
+      count_push( 1 );
+      if( signal == RBSignal::RBEOF )
+      {
+         close();
+      }
+      return( true );
+   }
+
+   /** body of the pop() overloads and pop_or_signal() **/
+   inline bool pop_item( T &item,
+                         RBSignal *signal,
+                         SlotMeta *meta,
+                         const bool on_signal )
+   {
+      if( ! wait_for_data( 1, on_signal ) )
+      {
+         return( false );
+      }
+      const size_t read_index( read_slot() );
+      if( signal != nullptr )
+      {
+         *signal = data->signal[ read_index ].sig;
+      }
+#if RB_META_ENABLED
+      if( meta != nullptr )
+      {
+         *meta = data->signal[ read_index ].meta;
+      }
+#endif
+      item = data->store[ read_index ].item;
+      trace_pop( read_index );
+      RB_PROBE2( pop, data, read_index );
+      consumed( 1 );
+      count_pop( 1 );
+      return( true );
+   }
+
+   /**
+    * stamp_meta - fill in the SlotMeta of the item going into
+    * index, compiles to nothing without any RB_META_* field.
+    * @param index - const size_t
+    * @param user  - const SlotMeta*, tag and flags, nullptr for 0
+    */
+   inline void stamp_meta( const size_t index, const SlotMeta *user )
+   {
+#if RB_META_ENABLED
+      SlotMeta &meta( data->signal[ index ].meta );
+#ifdef RB_META_SEQUENCE
+      meta.sequence  = push_sequence++;
+#endif
+#ifdef RB_META_TIMESTAMP
+      meta.timestamp = system_clock->getNanoseconds();
+#endif
+#ifdef RB_META_TAG
+      meta.tag       = ( user != nullptr ? user->tag   : 0 );
+      meta.flags     = ( user != nullptr ? user->flags : 0 );
+#endif
+#endif
+   }
+
+   /**
+    * published_size - items between the published read and write
+    * indices, what both ends can agree on.
+    * @return size_t
+    */
+   size_t   published_size()
+   {
+      const auto   wrap_write( Pointer::wrapIndicator( data->write_pt  ) ),
+                   wrap_read(  Pointer::wrapIndicator( data->read_pt   ) );
+
+      const auto   wpt( Pointer::val( data->write_pt ) ), 
+                   rpt( Pointer::val( data->read_pt  ) );
+      if( wpt == rpt )
+      {
+         if( wrap_read < wrap_write )
+         {
+            return( data->max_cap );
+         }
+         else if( wrap_read > wrap_write )
+         {
+            /**
+             * only the reader sees this: the writer has stored a
+             * wrapped index but not yet its wrap count, and the
+             * reader has caught up to it.  The reader can never
+             * lap the writer, so this is empty, not full.
+             */
+            return( 0 );
+         }
+         else
+         {
+            return( 0 );
+         }
+      }
+      else if( rpt < wpt )
+      {
+         return( wpt - rpt );
+      }
+      else if( rpt > wpt )
+      {
+         return( data->max_cap - rpt + wpt ); 
+      }
+      return( 0 );
+   }
+
+   /** next slot this end touches, past anything not yet published **/
+   inline size_t write_slot() const
+   {
+      return( ( Pointer::val( data->write_pt ) + write_pending ) %
+                 data->max_cap );
+   }
+
+   inline size_t read_slot() const
+   {
+      return( ( Pointer::val( data->read_pt ) + read_pending ) %
+                 data->max_cap );
+   }
+
+   /** true once this end's oldest unpublished op is timeout old **/
+   inline bool publish_due( const size_t pending, std::uint64_t &oldest )
+   {
+      if( publish_timeout == 0 )
+      {
+         return( false );
+      }
+      const std::uint64_t now( system_clock->getNanoseconds() );
+      if( pending == 1 )
+      {
+         oldest = now;
+         return( false );
+      }
+      return( now - oldest >= publish_timeout );
+   }
+
+   /**
+    * wrote / consumed - account for one push / n pops, publishing
+    * the index straight away unless defer_publication() said
+    * otherwise and none of the reasons to publish early hold.
+    */
+   inline void wrote( const RBSignal signal )
+   {
+      write_pending++;
+      if( publish_batch <= 1                 ||
+          signal != RBSignal::NONE           ||
+          write_pending >= publish_batch     ||
+          space_avail() == 0                 ||
+          published_size() == 0              ||
+          publish_due( write_pending, write_oldest ) )
+      {
+         flush_writes();
+      }
+   }
+
+   inline void consumed( const size_t n )
+   {
+      read_pending += n;
+      if( publish_batch <= 1                             ||
+          read_pending >= publish_batch                  ||
+          published_size() == data->max_cap              ||
+          size() == 0                                    ||
+          publish_due( read_pending, read_oldest ) )
+      {
+         flush_reads();
+      }
+   }
+
+   inline void flush_writes()
+   {
+      if( write_pending == 0 )
+      {
+         return;
+      }
+      Pointer::incBy( write_pending, data->write_pt );
+      write_pending = 0;
+      notify_data();
+   }
+
+   inline void flush_reads()
+   {
+      if( read_pending == 0 )
+      {
+         return;
+      }
+      Pointer::incBy( read_pending, data->read_pt );
+      read_pending = 0;
+      notify_space();
+   }
+
+   /**
+    * wait_for_space / wait_for_data - the wait loop behind every
+    * blocking call, returns once at least n slots are free or
+    * filled.  Anything this end hasn't published goes out first,
+    * the other end may be waiting on it.  Yields if NICE is
+    * defined and pauses either way.
+    * @param n         - const size_t
+    * @param on_signal - const bool, data only, also give up when an
+    *                    out of band signal is pending
+    * @return bool - false if the queue was abandoned (space), or
+    *                drained (or sent a signal, if on_signal) before
+    *                n items showed up (data)
+    */
+   inline bool wait_for_space( const size_t n )
+   {
+      if( space_avail() >= n )
+      {
+         return( true );
+      }
+      flush_writes();
+      RB_PROBE2( block, data, Direction::Producer );
+      RB_WAIT_COUNT( full_stats, waits, 1 );
+      const std::uint64_t start( timed_waits() ?
+                                 system_clock->getNanoseconds() : 0 );
+      bool ready( true );
+      do
+      {
+         if( abandoned() )
+         {
+            ready = false;
+            break;
+         }
+#ifdef NICE
+         std::this_thread::yield();
+         RB_WAIT_COUNT( full_stats, yields, 1 );
+#endif
+         pause();
+         RB_WAIT_COUNT( full_stats, spins, 1 );
+      }while( space_avail() < n );
+      RB_PROBE2( unblock, data, Direction::Producer );
+      if( timed_waits() )
+      {
+         const std::uint64_t blocked( system_clock->getNanoseconds() - start );
+         RB_WAIT_COUNT( full_stats, blocked_ns, blocked );
+         if( shared_stats != nullptr )
+         {
+            QueueStats::add( shared_stats->producer.waits );
+            QueueStats::add( shared_stats->producer.blocked_ns, blocked );
+         }
+      }
+      return( ready );
+   }
+
+   inline bool wait_for_data( const size_t n, const bool on_signal = false )
+   {
+      if( size() >= n )
+      {
+         return( true );
+      }
+      flush_reads();
+      RB_PROBE2( block, data, Direction::Consumer );
+      RB_WAIT_COUNT( empty_stats, waits, 1 );
+      const std::uint64_t start( timed_waits() ?
+                                 system_clock->getNanoseconds() : 0 );
+      bool ready( true );
+      do
+      {
+         if( closed() )
+         {
+            /** nothing more is coming, recheck now the last write is in **/
+            ready = ( size() >= n );
+            break;
+         }
+         if( on_signal && signal_pending() )
+         {
+            /** out of band signal jumps the queue, let the caller see it **/
+            ready = false;
+            break;
+         }
+#ifdef NICE
+         std::this_thread::yield();
+         RB_WAIT_COUNT( empty_stats, yields, 1 );
+#endif
+         pause();
+         RB_WAIT_COUNT( empty_stats, spins, 1 );
+      }while( size() < n );
+      RB_PROBE2( unblock, data, Direction::Consumer );
+      if( timed_waits() )
+      {
+         const std::uint64_t blocked( system_clock->getNanoseconds() - start );
+         RB_WAIT_COUNT( empty_stats, blocked_ns, blocked );
+         if( shared_stats != nullptr )
+         {
+            QueueStats::add( shared_stats->consumer.waits );
+            QueueStats::add( shared_stats->consumer.blocked_ns, blocked );
+         }
+      }
+      return( ready );
+   }
+
+   /** only read the clock on the slow path if someone wants the time **/
+   inline bool timed_waits() const
+   {
+#ifdef RB_WAIT_STATS
+      return( true );
+#else
+      return( shared_stats != nullptr );
+#endif
+   }
+
+   /**
+    * enable_stats - called by the RingBuffer publish_stats()
+    * functions once the stats segment is mapped, records which
+    * ends live in this process.
+    * @param stats    - QueueStats*, in SHM
+    * @param producer - const bool, this process pushes
+    * @param consumer - const bool, this process pops
+    */
+   void enable_stats( QueueStats *stats,
+                      const bool producer,
+                      const bool consumer )
+   {
+      if( producer )
+      {
+         stats->producer.pid.store( getpid(), std::memory_order_relaxed );
+      }
+      if( consumer )
+      {
+         stats->consumer.pid.store( getpid(), std::memory_order_relaxed );
+      }
+      (this)->shared_stats = stats;
+   }
+
+   inline void count_push( const size_t n )
+   {
+      if( shared_stats != nullptr )
+      {
+         QueueStats::add( shared_stats->producer.items, n );
+      }
+   }
+
+   inline void count_pop( const size_t n )
+   {
+      if( shared_stats != nullptr )
+      {
+         QueueStats::add( shared_stats->consumer.items, n );
+      }
+   }
+
+   static inline void pause()
+   {
+      spin_pause();
+   }
+
+   /**
+    * notify_data / notify_space - wake anyone sleeping on this
+    * queue through a QueueSet or executor.  Unless one is
+    * watching the queue this is a load of a line that is only
+    * written when they come and go.  Otherwise it is a fence and
+    * a load of the waiter count: the fence orders the pointer (or
+    * close / signal) store before the waiters load, pairing with
+    * the seq_cst waiters increment in QueueSet::wait(), otherwise
+    * the load can pass the store and miss a sleeper that is just
+    * going down (store buffer, even on x86).  A publish racing the
+    * very first watcher can still miss it, the watcher's sleep
+    * slice bounds that.  Called once per published batch, not per
+    * item, under defer_publication().
+    */
+   inline void notify_data()
+   {
+      if( data->control->watched.load( std::memory_order_relaxed ) == 0 )
+      {
+         return;
+      }
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( data->control->data_waiters.load( std::memory_order_relaxed ) != 0 )
+      {
+         data->control->data_epoch.fetch_add( 1, std::memory_order_release );
+         RB_PROBE2( wake, data, Direction::Consumer );
+         Futex::wake( &data->control->data_epoch );
+      }
+   }
+
+   inline void notify_space()
+   {
+      if( data->control->watched.load( std::memory_order_relaxed ) == 0 )
+      {
+         return;
+      }
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      if( data->control->space_waiters.load( std::memory_order_relaxed ) != 0 )
+      {
+         data->control->space_epoch.fetch_add( 1, std::memory_order_release );
+         RB_PROBE2( wake, data, Direction::Producer );
+         Futex::wake( &data->control->space_epoch );
+      }
+   }
+
+   /**
+    * enable_trace - called by the RingBuffer trace() functions once
+    * they've allocated a stamp per slot.  Each end counts its own
+    * items so they agree on which ones are sampled without having
+    * to mark the rest.
+    * @param stamps  - std::uint64_t*, max_cap entries
+    * @param latency - Histogram*, nullptr on an end that only pushes
+    * @param every   - const size_t, sample one item in every
+    */
+   void enable_trace( std::uint64_t *stamps,
+                      Histogram *latency,
+                      const size_t every )
+   {
+      assert( every > 0 );
+      (this)->latency        = latency;
+      (this)->trace_every    = every;
+      (this)->push_countdown = 1;
+      (this)->pop_countdown  = 1;
+      (this)->stamps         = stamps;
+   }
+
+   /** stamp the item going into index, if it is being sampled **/
+   inline void trace_push( const size_t index )
+   {
+      if( stamps != nullptr && --push_countdown == 0 )
+      {
+         push_countdown  = trace_every;
+         stamps[ index ] = system_clock->getNanoseconds();
+      }
+   }
+
+   /** record the latency of the item leaving index, if sampled **/
+   inline void trace_pop( const size_t index )
+   {
+      if( stamps != nullptr && --pop_countdown == 0 )
+      {
+         pop_countdown = trace_every;
+         if( latency != nullptr )
+         {
+            const std::uint64_t now( system_clock->getNanoseconds() );
+            const std::uint64_t then( stamps[ index ] );
+            latency->record( now > then ? now - then : 0 );
+         }
+      }
+   }
+
    /**
     * Buffer structure that is the core of the ring
     * buffer.
@@ -383,8 +1085,37 @@ protected:
     * only the signal argument is called.
     */
    volatile bool                allocate_called;
-   /** TODO, this needs to get moved into the buffer for SHM **/
-   volatile bool                write_finished;
+   /** where the endpoints should run, default leaves it to the OS **/
+   Placement                    placement;
+   /** latency tracing, off (nullptr) unless trace() was called **/
+   std::uint64_t               *stamps;
+   Histogram                   *latency;
+   size_t                       trace_every;
+   /** local to the producer and consumer respectively **/
+   size_t                       push_countdown;
+   size_t                       pop_countdown;
+   /** rbstat counters in SHM, nullptr unless publish_stats() was called **/
+   QueueStats                  *shared_stats;
+#ifdef RB_WAIT_STATS
+   /** producer waiting on a full queue, consumer on an empty one **/
+   WaitStats                    full_stats;
+   WaitStats                    empty_stats;
+#endif
+   /**
+    * deferred publication, see defer_publication().  The pending
+    * counts are ops done but not yet visible to the other end,
+    * each only touched by its own end's thread.
+    */
+   size_t                       publish_batch;
+   std::uint64_t                publish_timeout;
+   size_t                       write_pending;
+   size_t                       read_pending;
+   std::uint64_t                write_oldest;
+   std::uint64_t                read_oldest;
+#ifdef RB_META_SEQUENCE
+   /** producer's count, stamped into each SlotMeta **/
+   std::uint64_t                push_sequence;
+#endif
 };
 
 
@@ -399,8 +1130,7 @@ public:
     * data structures.
     */
    RingBufferBase() : data( nullptr ),
-                      allocate_called( false ),
-                      write_finished( false )
+                      allocate_called( false )
    {
    }
    
@@ -419,32 +1149,23 @@ public:
       return( 1 );
    }
 
+   /**
+    * get_signal / send_signal - same out of band channel as the
+    * real queues, through the control block.
+    */
    RBSignal get_signal() 
    {
-#if 0   
-      /** 
-       * there are two signalling paths, the one 
-       * we'll give the highest priority to is the 
-       * asynchronous one.
-       */
-      const auto signal_queue( data->store[ 0 ].signal );
-      /**
-       * TODO, fix this
-       */
-      const auto signal_local( (this)->signal_a );
-      if( signal_local == RBSignal::NONE )
-      {
-         return( signal_queue );
-      }
-      /** there must be something in the local signal **/
-      //(this)->signal = RBSignal::NONE;
-#endif      
-      return( RBSignal::NONE );
+      return( data->control->pop_signal() );
+   }
+
+   bool send_signal( const RBSignal &signal )
+   {
+      return( data->control->push_signal( signal ) );
    }
 
-   void send_signal( const RBSignal &signal )
+   bool signal_pending() const
    {
-      //(this)->signal = signal;
+      return( data->control->signal_pending() );
    }
 
    /**
@@ -489,11 +1210,12 @@ public:
     * called prior to calling this function.
     * @param signal - const RBSignal signal, default: NONE
     */
-   void push( const RBSignal signal = RBSignal::NONE )
+   bool push( const RBSignal signal = RBSignal::NONE )
    {
-      if( ! (this)->allocate_called ) return;
+      if( ! (this)->allocate_called ) return( false );
       data->signal[ 0 ].sig = signal;
       (this)->allocate_called = false;
+      return( true );
    }
 
    /**
@@ -501,11 +1223,12 @@ public:
     * increment the counter and simply return;
     * @param   item, T
     */
-   void  push( T &item, const RBSignal signal = RBSignal::NONE )
+   bool  push( T &item, const RBSignal signal = RBSignal::NONE )
    {
       data->store [ 0 ].item  = item;
       /** a bit awkward since it gives the same behavior as the actual queue **/
       data->signal[ 0 ].sig  = signal;
+      return( true );
    }
 
    /**
@@ -515,7 +1238,7 @@ public:
     * @param   signal - const RBSignal, set if you want to send a signal
     */
    template< class iterator_type >
-   void insert( iterator_type begin, 
+   bool insert( iterator_type begin, 
                 iterator_type end, 
                 const RBSignal signal = RBSignal::NONE )
    {
@@ -525,6 +1248,7 @@ public:
          begin++;
       }
       data->signal[ 0 ].sig = signal;
+      return( true );
    }
  
    /**
@@ -533,14 +1257,47 @@ public:
     * @return  T, item read.  It is removed from the
     *          q as soon as it is read
     */
-   void pop( T &item, RBSignal *signal = nullptr )
+   bool pop( T &item, RBSignal *signal = nullptr )
    {
       item  = data->store[ 0 ].item;
       if( signal != nullptr )
       {
          *signal = data->signal[ 0 ].sig;
       }
+      return( true );
+   }
+
+   /** pop_or_signal - pending signals first, otherwise pop() **/
+   bool pop_or_signal( T &item, RBSignal &signal )
+   {
+      if( signal_pending() )
+      {
+         signal = get_signal();
+         return( false );
+      }
+      return( pop( item, &signal ) );
    }
+
+#if RB_META_ENABLED
+   /** SlotMeta versions of push / pop, the metadata isn't kept **/
+   bool push( const SlotMeta &meta, const RBSignal signal = RBSignal::NONE )
+   {
+      return( push( signal ) );
+   }
+
+   bool push( T &item,
+              const SlotMeta &meta,
+              const RBSignal signal = RBSignal::NONE )
+   {
+      return( push( item, signal ) );
+   }
+
+   bool pop( T &item, SlotMeta &meta, RBSignal *signal = nullptr )
+   {
+      meta = SlotMeta();
+      return( pop( item, signal ) );
+   }
+#endif
   
    /**
     * pop_range - dummy function version of the real one above
@@ -552,7 +1309,7 @@ public:
     * @param output - std:;array< T, N >*
     */
    template< size_t N >
-   void  pop_range( 
+   bool  pop_range( 
       std::array< T, N > &output, 
       std::array< RBSignal, N > *signal = nullptr )
    {
@@ -571,6 +1328,7 @@ public:
             output[ i ]    = data->store[ 0 ].item;
          }
       }
+      return( true );
    }
 
 
@@ -601,10 +1359,39 @@ public:
    {
    }
 
+   /** never runs dry, closing changes nothing **/
+   void close()
+   {
+   }
+
+   void abandon()
+   {
+   }
+
+   bool closed() const
+   {
+      return( false );
+   }
+
+   bool drained()
+   {
+      return( false );
+   }
+
+   bool abandoned() const
+   {
+      return( false );
+   }
+
+   /** never waits, always zero **/
+   WaitCounts wait_stats( const Direction dir ) const
+   {
+      return( WaitCounts() );
+   }
+
 protected:
    /** go ahead and allocate a buffer as a heap, doesn't really matter **/
    Buffer::Data< T, RingBufferType::Heap >      *data;
    volatile bool                                allocate_called;
-   volatile bool                                write_finished;
 };
 #endif /* END _RINGBUFFERBASE_TCC_ */
@@ -0,0 +1,281 @@
+/**
+ * runtime.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 14:02:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <cassert>
+#include <cstdio>
+#include <chrono>
+#include <thread>
+#include "runtime.hpp"
+#include "affinity.hpp"
+#include "spinwait.hpp"
+
+/**
+ * WorkDeque - fixed size Chase-Lev deque of kernels.  The owning
+ * worker pushes and pops at the bottom, any other worker may
+ * steal from the top.  Sized to hold every kernel so it never
+ * has to grow.
+ */
+class WorkDeque
+{
+public:
+   WorkDeque( const size_t n ) : top( 0 ),
+                                 bottom( 0 ),
+                                 mask( 0 ),
+                                 buffer( nullptr )
+   {
+      size_t cap( 1 );
+      while( cap < n )
+      {
+         cap <<= 1;
+      }
+      mask   = cap - 1;
+      buffer = new std::atomic< Kernel* >[ cap ];
+   }
+
+   ~WorkDeque()
+   {
+      delete[]( buffer );
+   }
+
+   void push( Kernel *kernel )
+   {
+      const std::int64_t b( bottom.load( std::memory_order_relaxed ) );
+      assert( b - top.load( std::memory_order_acquire ) <= (std::int64_t) mask );
+      buffer[ b & mask ].store( kernel, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      bottom.store( b + 1, std::memory_order_relaxed );
+   }
+
+   Kernel* pop()
+   {
+      const std::int64_t b( bottom.load( std::memory_order_relaxed ) - 1 );
+      bottom.store( b, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      std::int64_t t( top.load( std::memory_order_relaxed ) );
+      if( t > b )
+      {
+         bottom.store( b + 1, std::memory_order_relaxed );
+         return( nullptr );
+      }
+      Kernel *kernel( buffer[ b & mask ].load( std::memory_order_relaxed ) );
+      if( t == b )
+      {
+         /** last one, race any thief for it **/
+         if( ! top.compare_exchange_strong( t, t + 1,
+                                            std::memory_order_seq_cst,
+                                            std::memory_order_relaxed ) )
+         {
+            kernel = nullptr;
+         }
+         bottom.store( b + 1, std::memory_order_relaxed );
+      }
+      return( kernel );
+   }
+
+   Kernel* steal()
+   {
+      std::int64_t t( top.load( std::memory_order_acquire ) );
+      std::atomic_thread_fence( std::memory_order_seq_cst );
+      const std::int64_t b( bottom.load( std::memory_order_acquire ) );
+      if( t >= b )
+      {
+         return( nullptr );
+      }
+      Kernel *kernel( buffer[ t & mask ].load( std::memory_order_relaxed ) );
+      if( ! top.compare_exchange_strong( t, t + 1,
+                                         std::memory_order_seq_cst,
+                                         std::memory_order_relaxed ) )
+      {
+         return( nullptr );
+      }
+      return( kernel );
+   }
+
+private:
+   /** padded rather than aligned, plain new ignores alignas here **/
+   std::atomic< std::int64_t >                 top;
+   char                                        pad_top[ 64 ];
+   std::atomic< std::int64_t >                 bottom;
+   char                                        pad_bottom[ 64 ];
+   size_t                                      mask;
+   std::atomic< Kernel* >                     *buffer;
+};
+
+
+Kernel::Kernel()
+{
+   /** nothing to do **/
+}
+
+Kernel::~Kernel()
+{
+   /** nothing to do, queues are owned elsewhere **/
+}
+
+size_t
+Kernel::available( const size_t batch )
+{
+   size_t n( batch );
+   for( const Port &port : ports )
+   {
+      const size_t count( port.count( port.queue ) );
+      if( count == 0 && port.done( port.queue ) )
+      {
+         /** fails without blocking, let run() see it once the rest allow **/
+         continue;
+      }
+      if( count < n )
+      {
+         n = count;
+      }
+   }
+   return( n );
+}
+
+
+Runtime::Runtime( const size_t nworkers,
+                  const std::vector< int > cores,
+                  const size_t batch ) : nworkers( nworkers ),
+                                         cores( cores ),
+                                         batch( batch ),
+                                         live( 0 )
+{
+   assert( nworkers > 0 );
+   assert( batch > 0 );
+}
+
+Runtime::~Runtime()
+{
+   for( WorkDeque *deque : deques )
+   {
+      delete( deque );
+   }
+}
+
+void
+Runtime::add( Kernel &kernel )
+{
+   kernels.push_back( &kernel );
+}
+
+void
+Runtime::run()
+{
+   for( WorkDeque *deque : deques )
+   {
+      delete( deque );
+   }
+   deques.clear();
+   for( size_t i( 0 ); i < nworkers; i++ )
+   {
+      deques.push_back( new WorkDeque( kernels.size() ) );
+   }
+   /** deal kernels out round robin, stealing evens things out **/
+   for( size_t i( 0 ); i < kernels.size(); i++ )
+   {
+      deques[ i % nworkers ]->push( kernels[ i ] );
+   }
+   live.store( kernels.size(), std::memory_order_release );
+   std::vector< std::thread > threads;
+   for( size_t i( 0 ); i < nworkers; i++ )
+   {
+      threads.emplace_back( &Runtime::worker, this, i );
+   }
+   for( auto &t : threads )
+   {
+      t.join();
+   }
+}
+
+void
+Runtime::worker( const size_t id )
+{
+   if( cores.size() > 0 )
+   {
+      Affinity::pin( cores[ id % cores.size() ] );
+   }
+   WorkDeque &own( *deques[ id ] );
+   std::vector< Kernel* > deferred;
+   std::uint32_t idle_rounds( 0 );
+   std::uint32_t victim_seed( (std::uint32_t) id + 1 );
+   while( live.load( std::memory_order_acquire ) > 0 )
+   {
+      /**
+       * one round, each kernel we hold is looked at once, they're
+       * held aside until the end of the round so the deque (LIFO
+       * for the owner) doesn't hand back the same kernel forever.
+       */
+      size_t ran( 0 );
+      Kernel *kernel( nullptr );
+      while( ( kernel = own.pop() ) != nullptr )
+      {
+         const size_t n( kernel->available( batch ) );
+         if( n > 0 )
+         {
+            ran++;
+            if( kernel->run( n ) == KernelStatus::Stop )
+            {
+               live.fetch_sub( 1, std::memory_order_acq_rel );
+               continue;
+            }
+         }
+         deferred.push_back( kernel );
+      }
+      for( Kernel *k : deferred )
+      {
+         own.push( k );
+      }
+      deferred.clear();
+      if( ran > 0 )
+      {
+         idle_rounds = 0;
+         continue;
+      }
+      /** nothing of ours could run, try to take one from someone else **/
+      if( nworkers > 1 )
+      {
+         victim_seed = victim_seed * 1103515245 + 12345;
+         size_t victim( ( victim_seed >> 16 ) % ( nworkers - 1 ) );
+         if( victim >= id )
+         {
+            victim++;
+         }
+         Kernel *stolen( deques[ victim ]->steal() );
+         if( stolen != nullptr )
+         {
+            own.push( stolen );
+            idle_rounds = 0;
+            continue;
+         }
+      }
+      idle_rounds++;
+      if( idle_rounds < 64 )
+      {
+         spin_pause();
+      }
+      else if( idle_rounds < 128 )
+      {
+         std::this_thread::yield();
+      }
+      else
+      {
+         std::this_thread::sleep_for( std::chrono::microseconds( 50 ) );
+      }
+   }
+}
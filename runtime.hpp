@@ -0,0 +1,174 @@
+/**
+ * runtime.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 14:02:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _RUNTIME_HPP_
+#define _RUNTIME_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include "ringbufferbase.tcc"
+
+enum KernelStatus { Proceed, Stop };
+
+class WorkDeque;
+
+/**
+ * Kernel - one pipeline stage.  Register the queues it reads
+ * with input() and the ones it writes with output(), then hand
+ * it to a Runtime.  run() is only called once every input has
+ * at least one item and every output has room for one, with
+ * the number of items that can be moved without blocking.  A
+ * drained input (closed and empty) or an abandoned output never
+ * blocks, pop() / push() just return false, so those ports
+ * don't hold the kernel back: it runs once the rest of its
+ * ports allow, sees the failure and can Stop.
+ */
+class Kernel
+{
+public:
+   Kernel();
+   virtual ~Kernel();
+
+   /**
+    * run - do up to n items worth of work, n is at least one and
+    * no more than the Runtime's batch size.
+    * @param n - const size_t
+    * @return KernelStatus - Stop once this kernel is finished
+    */
+   virtual KernelStatus run( const size_t n ) = 0;
+
+   /**
+    * input - register a queue this kernel pops from.
+    * @param queue - RingBufferBase&, must outlive the kernel
+    */
+   template < class T, RingBufferType type >
+   void input( RingBufferBase< T, type > &queue )
+   {
+      ports.push_back( Port{ &queue,
+                             Kernel::items< T, type >,
+                             Kernel::drained< T, type > } );
+   }
+
+   /**
+    * output - register a queue this kernel pushes to.
+    * @param queue - RingBufferBase&, must outlive the kernel
+    */
+   template < class T, RingBufferType type >
+   void output( RingBufferBase< T, type > &queue )
+   {
+      ports.push_back( Port{ &queue,
+                             Kernel::space< T, type >,
+                             Kernel::abandoned< T, type > } );
+   }
+
+   /**
+    * available - how many items this kernel can move right now
+    * without blocking on any port, capped at batch.  Drained
+    * inputs and abandoned outputs don't count against it, a
+    * kernel with no other ports gets the full batch.
+    * @param batch - const size_t
+    * @return size_t, zero if not runnable
+    */
+   size_t available( const size_t batch );
+
+private:
+   struct Port
+   {
+      void     *queue;
+      size_t  (*count)( void* );
+      /** true once the port fails rather than blocks **/
+      bool    (*done)( void* );
+   };
+
+   template < class T, RingBufferType type >
+   static size_t items( void *queue )
+   {
+      return( reinterpret_cast< RingBufferBase< T, type >* >( queue )->size() );
+   }
+
+   template < class T, RingBufferType type >
+   static bool drained( void *queue )
+   {
+      return( reinterpret_cast< RingBufferBase< T, type >* >( queue )->drained() );
+   }
+
+   template < class T, RingBufferType type >
+   static size_t space( void *queue )
+   {
+      return( reinterpret_cast< RingBufferBase< T, type >* >( queue )->space_avail() );
+   }
+
+   template < class T, RingBufferType type >
+   static bool abandoned( void *queue )
+   {
+      return( reinterpret_cast< RingBufferBase< T, type >* >( queue )->abandoned() );
+   }
+
+   std::vector< Port > ports;
+};
+
+/**
+ * Runtime - runs kernels on a small pool of (optionally pinned)
+ * worker threads instead of one thread per stage.  Each worker
+ * owns a work stealing deque of kernels, it cycles through them
+ * running whichever are runnable and a worker that finds none
+ * of its own runnable steals one from another worker.  A kernel
+ * sits in exactly one deque (or is being run) at any time so it
+ * is never run by two threads at once, which keeps each queue
+ * end single threaded.
+ */
+class Runtime
+{
+public:
+   /**
+    * Runtime - constructor
+    * @param nworkers - const size_t, worker threads
+    * @param cores    - std::vector< int >, pinning, round robin
+    * @param batch    - const size_t, max items per activation
+    */
+   Runtime( const size_t nworkers,
+            const std::vector< int > cores = std::vector< int >(),
+            const size_t batch = 64 );
+
+   virtual ~Runtime();
+
+   /**
+    * add - register a kernel, call before run().
+    * @param kernel - Kernel&, must outlive run()
+    */
+   void add( Kernel &kernel );
+
+   /**
+    * run - start the workers and return once every kernel has
+    * returned Stop.
+    */
+   void run();
+
+private:
+   void worker( const size_t id );
+
+   std::vector< Kernel* >       kernels;
+   std::vector< WorkDeque* >    deques;
+   const size_t                 nworkers;
+   const std::vector< int >     cores;
+   const size_t                 batch;
+   std::atomic< size_t >        live;
+};
+#endif /* END _RUNTIME_HPP_ */
@@ -0,0 +1,116 @@
+/**
+ * seqlock.tcc -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 10:31:05 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SEQLOCK_TCC_
+#define _SEQLOCK_TCC_  1
+#include <atomic>
+#include <cstdint>
+#include <type_traits>
+#include "spinwait.hpp"
+
+/**
+ * SeqLock - single writer, many reader cell holding one value
+ * of type T.  The version is odd while a write is in progress
+ * and bumped by two per completed write, readers retry until
+ * they get the same even version on both sides of their copy.
+ * All zero memory is a valid (never written) SeqLock so it can
+ * be placed directly in a zeroed heap or SHM region.
+ * @templateparam T - trivially copyable type
+ */
+template < class T > class SeqLock
+{
+   static_assert( std::is_trivially_copyable< T >::value,
+                  "SeqLock requires a trivially copyable type" );
+public:
+   SeqLock() : seq( 0 ),
+               value()
+   {
+   }
+
+   /**
+    * write - publish val, only one thread may ever write.
+    * @param val - const T&
+    */
+   inline void write( const T &val )
+   {
+      const std::uint64_t current( seq.load( std::memory_order_relaxed ) );
+      seq.store( current + 1, std::memory_order_relaxed );
+      std::atomic_thread_fence( std::memory_order_release );
+      value = val;
+      seq.store( current + 2, std::memory_order_release );
+   }
+
+   /**
+    * try_read - a single attempt at a consistent copy.
+    * @param out     - T&, only set if return is true
+    * @param version - std::uint64_t*, version of copy, optional
+    * @return bool   - false if a write overlapped the copy
+    */
+   inline bool try_read( T &out, std::uint64_t *version = nullptr ) const
+   {
+      const std::uint64_t before( seq.load( std::memory_order_acquire ) );
+      if( before & 1 )
+      {
+         return( false );
+      }
+      const T copy( value );
+      std::atomic_thread_fence( std::memory_order_acquire );
+      if( seq.load( std::memory_order_relaxed ) != before )
+      {
+         return( false );
+      }
+      out = copy;
+      if( version != nullptr )
+      {
+         *version = before;
+      }
+      return( true );
+   }
+
+   /**
+    * read - spin until a consistent copy is made, the writer
+    * never blocks so this is bounded by the length of a write.
+    * @param version - std::uint64_t*, version of copy, optional
+    * @return T
+    */
+   inline T read( std::uint64_t *version = nullptr ) const
+   {
+      T out;
+      while( ! try_read( out, version ) )
+      {
+         spin_pause();
+      }
+      return( out );
+   }
+
+   /**
+    * version - current version, zero if never written, two
+    * times the number of completed writes otherwise.
+    * @return std::uint64_t
+    */
+   inline std::uint64_t version() const
+   {
+      return( seq.load( std::memory_order_acquire ) );
+   }
+
+private:
+   std::atomic< std::uint64_t > seq;
+   T                            value;
+};
+#endif /* END _SEQLOCK_TCC_ */
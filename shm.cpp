@@ -8,6 +8,7 @@
 #include <sys/mman.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/socket.h>
 #include <stdlib.h>
 #include <errno.h>
 #include <cstring>
@@ -131,7 +132,9 @@ SHM::Init( const char *key,
 
 /** 
  * Open - opens the shared memory segment with the file
- * descriptor stored at key.
+ * descriptor stored at key.  Never creates or unlinks it, the
+ * segment belongs to whoever called Init, and a segment Init
+ * hasn't sized yet throws so the caller can retry.
  * @param   key - const char *
  * @return  void* - start of allocated memory, or NULL if
  *                  error
@@ -149,7 +152,7 @@ SHM::Open( const char *key )
    memset( &st, 
            0x0, 
            sizeof( struct stat ) );
-   const int flags( O_RDWR | O_CREAT );
+   const int flags( O_RDWR );
    mode_t mode( 0 );
    errno = success;
    fd = shm_open( key, 
@@ -167,9 +170,16 @@ SHM::Open( const char *key )
    if( fstat( fd, &st ) != success )
    {
       std::stringstream ss;
-      ss << "Failed to stat shm region with the following error: " << strerror( errno ) << ",\n";
-      ss << "unlinking.";
-      shm_unlink( key );
+      ss << "Failed to stat shm region with the following error: " << strerror( errno );
+      close( fd );
+      throw bad_shm_alloc( ss.str() );
+   }
+   /* created but not truncated yet, mmap would fail */
+   if( st.st_size == 0 )
+   {
+      std::stringstream ss;
+      ss << "SHM with key \"" << key << "\" isn't sized yet";
+      close( fd );
       throw bad_shm_alloc( ss.str() );
    }
    void *out( NULL );
@@ -183,9 +193,8 @@ SHM::Open( const char *key )
    if( out == MAP_FAILED )
    {
       std::stringstream ss;
-      ss << "Failed to mmap shm region with the following error: " << strerror( errno ) << ",\n";
-      ss << "unlinking.";
-      shm_unlink( key );
+      ss << "Failed to mmap shm region with the following error: " << strerror( errno );
+      close( fd );
       throw bad_shm_alloc( ss.str() );
    }
    /* close fd */
@@ -194,6 +203,217 @@ SHM::Open( const char *key )
    return( out );
 }
 
+void*
+SHM::OpenReadOnly( const char *key, size_t &nbytes )
+{
+   assert( key != nullptr );
+   assert( strlen( key ) > 0 );
+   const int success( 0 );
+   const int failure( -1 );
+   errno = success;
+   const int fd( shm_open( key, O_RDONLY, 0 ) );
+   if( fd == failure )
+   {
+      std::stringstream ss;
+      ss << "Failed to open SHM with key \"" << key << "\" read only, with the following error code: ";
+      ss << strerror( errno );
+      throw bad_shm_alloc( ss.str() );
+   }
+   struct stat st;
+   memset( &st,
+           0x0,
+           sizeof( struct stat ) );
+   errno = success;
+   if( fstat( fd, &st ) != success || st.st_size == 0 )
+   {
+      std::stringstream ss;
+      ss << "Failed to stat shm region \"" << key << "\" with the following error: " <<
+         strerror( errno );
+      close( fd );
+      throw bad_shm_alloc( ss.str() );
+   }
+   errno = success;
+   void *out( mmap( NULL,
+                    st.st_size,
+                    PROT_READ,
+                    MAP_SHARED,
+                    fd,
+                    0 ) );
+   close( fd );
+   if( out == MAP_FAILED )
+   {
+      std::stringstream ss;
+      ss << "Failed to mmap shm region read only with the following error: " << strerror( errno );
+      throw bad_shm_alloc( ss.str() );
+   }
+   nbytes = st.st_size;
+   return( out );
+}
+
+void*
+SHM::InitAnonymous( const char *name,
+                    size_t nbytes,
+                    int    &fd,
+                    bool   seal )
+{
+   assert( name != nullptr );
+#if defined __linux__ && defined MFD_CLOEXEC
+   const int success( 0 );
+   const int failure( -1 );
+   errno = success;
+   /** close on exec only, fork still inherits it **/
+   fd = memfd_create( name, MFD_CLOEXEC | ( seal ? MFD_ALLOW_SEALING : 0 ) );
+   if( fd == failure )
+   {
+      std::stringstream ss;
+      ss << "Failed to create memfd \"" << name << "\", error code returned: ";
+      ss << strerror( errno );
+      throw bad_shm_alloc( ss.str() );
+   }
+   errno = success;
+   if( ftruncate( fd, nbytes ) != success ||
+       ( seal && fcntl( fd, F_ADD_SEALS, 
+                        F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL ) != success ) )
+   {
+      std::stringstream ss;
+      ss << "Failed to size memfd (" << fd << ") ";
+      ss << "to (" << nbytes << ") bytes.  Error code returned: ";
+      ss << strerror( errno );
+      close( fd );
+      fd = failure;
+      throw bad_shm_alloc( ss.str() );
+   }
+   errno = success;
+   void *out( mmap( NULL,
+                    nbytes,
+                    ( PROT_READ | PROT_WRITE ),
+                    MAP_SHARED,
+                    fd,
+                    0 ) );
+   if( out == MAP_FAILED )
+   {
+      std::stringstream ss;
+      ss << "Failed to mmap memfd with the following error: " << strerror( errno );
+      close( fd );
+      fd = failure;
+      throw bad_shm_alloc( ss.str() );
+   }
+   /** fresh memfd pages read as zero, nothing to memset **/
+   return( out );
+#else
+   (void) nbytes;
+   (void) seal;
+   fd = -1;
+   throw bad_shm_alloc( "Anonymous (memfd) SHM isn't supported on this platform" );
+#endif
+}
+
+void*
+SHM::OpenFd( const int fd, size_t &nbytes )
+{
+   const int success( 0 );
+   struct stat st;
+   memset( &st,
+           0x0,
+           sizeof( struct stat ) );
+   errno = success;
+   if( fstat( fd, &st ) != success || st.st_size == 0 )
+   {
+      std::stringstream ss;
+      ss << "Failed to stat shm fd (" << fd << ") with the following error: " <<
+         strerror( errno );
+      throw bad_shm_alloc( ss.str() );
+   }
+   errno = success;
+   void *out( mmap( NULL,
+                    st.st_size,
+                    ( PROT_READ | PROT_WRITE ),
+                    MAP_SHARED,
+                    fd,
+                    0 ) );
+   if( out == MAP_FAILED )
+   {
+      std::stringstream ss;
+      ss << "Failed to mmap shm fd (" << fd << ") with the following error: " <<
+         strerror( errno );
+      throw bad_shm_alloc( ss.str() );
+   }
+   nbytes = st.st_size;
+   return( out );
+}
+
+bool
+SHM::SendFd( const int socket, const int fd )
+{
+   char byte( 0 );
+   struct iovec iov;
+   iov.iov_base = &byte;
+   iov.iov_len  = sizeof( byte );
+   union
+   {
+      struct cmsghdr header;
+      char           buffer[ CMSG_SPACE( sizeof( int ) ) ];
+   } control;
+   memset( &control, 0x0, sizeof( control ) );
+   struct msghdr msg;
+   memset( &msg, 0x0, sizeof( msg ) );
+   msg.msg_iov        = &iov;
+   msg.msg_iovlen     = 1;
+   msg.msg_control    = control.buffer;
+   msg.msg_controllen = sizeof( control.buffer );
+   struct cmsghdr *cmsg( CMSG_FIRSTHDR( &msg ) );
+   cmsg->cmsg_level   = SOL_SOCKET;
+   cmsg->cmsg_type    = SCM_RIGHTS;
+   cmsg->cmsg_len     = CMSG_LEN( sizeof( int ) );
+   memcpy( CMSG_DATA( cmsg ), &fd, sizeof( int ) );
+   ssize_t sent( -1 );
+   do
+   {
+      sent = sendmsg( socket, &msg, 0 );
+   }while( sent < 0 && errno == EINTR );
+   return( sent == sizeof( byte ) );
+}
+
+int
+SHM::ReceiveFd( const int socket )
+{
+   char byte( 0 );
+   struct iovec iov;
+   iov.iov_base = &byte;
+   iov.iov_len  = sizeof( byte );
+   union
+   {
+      struct cmsghdr header;
+      char           buffer[ CMSG_SPACE( sizeof( int ) ) ];
+   } control;
+   memset( &control, 0x0, sizeof( control ) );
+   struct msghdr msg;
+   memset( &msg, 0x0, sizeof( msg ) );
+   msg.msg_iov        = &iov;
+   msg.msg_iovlen     = 1;
+   msg.msg_control    = control.buffer;
+   msg.msg_controllen = sizeof( control.buffer );
+   ssize_t received( -1 );
+   do
+   {
+      received = recvmsg( socket, &msg, MSG_CMSG_CLOEXEC );
+   }while( received < 0 && errno == EINTR );
+   if( received <= 0 )
+   {
+      return( -1 );
+   }
+   struct cmsghdr *cmsg( CMSG_FIRSTHDR( &msg ) );
+   if( cmsg == nullptr || cmsg->cmsg_level != SOL_SOCKET ||
+       cmsg->cmsg_type != SCM_RIGHTS ||
+       cmsg->cmsg_len != CMSG_LEN( sizeof( int ) ) )
+   {
+      return( -1 );
+   }
+   int fd( -1 );
+   memcpy( &fd, CMSG_DATA( cmsg ), sizeof( int ) );
+   return( fd );
+}
+
 bool
 SHM::Close( const char *key,
             void *ptr,
@@ -50,13 +50,69 @@ public:
 
    /** 
     * Open - opens the shared memory segment with the file
-    * descriptor stored at key.
+    * descriptor stored at key.  Never creates or unlinks it,
+    * throws bad_shm_alloc until the creator's Init has sized it.
     * @param   key - const char *
     * @return  void* - start of allocated memory, or NULL if
     *                  error
     */
    static void*   Open( const char *key );
 
+   /**
+    * OpenReadOnly - map an existing segment read only, for
+    * observers that must not be able to disturb it.  Never
+    * creates or unlinks anything.
+    * @param   key    - const char *
+    * @param   nbytes - size_t&, set to the segment's size
+    * @return  void* - start of mapped memory, throws
+    *                  bad_shm_alloc on error
+    */
+   static void*   OpenReadOnly( const char *key, size_t &nbytes );
+
+   /**
+    * InitAnonymous - like Init but backed by a memfd, so there is
+    * no name in /dev/shm to collide with or clean up.  Other
+    * processes get at it through the fd, inherited across fork
+    * or passed with SendFd.  Sealed segments can't be grown or
+    * shrunk by anyone (a shrink would SIGBUS every mapping).
+    * Throws bad_shm_alloc on error, not supported off Linux.
+    * @param   name   - const char *, shows up in /proc/pid/fd only
+    * @param   nbytes - size_t
+    * @param   fd     - int&, set to the memfd, caller closes it
+    * @param   seal   - bool, default: true
+    * @return  void* - start of the zeroed mapping
+    */
+   static void*   InitAnonymous( const char *name,
+                                 size_t nbytes,
+                                 int    &fd,
+                                 bool   seal = true );
+
+   /**
+    * OpenFd - map a segment from an fd, e.g. one made by
+    * InitAnonymous.  The fd isn't needed once this returns.
+    * @param   fd     - const int
+    * @param   nbytes - size_t&, set to the segment's size
+    * @return  void* - start of mapped memory, throws
+    *                  bad_shm_alloc on error
+    */
+   static void*   OpenFd( const int fd, size_t &nbytes );
+
+   /**
+    * SendFd - pass fd over a connected AF_UNIX socket (SCM_RIGHTS),
+    * the receiver gets its own descriptor for the same segment.
+    * @param   socket - const int
+    * @param   fd     - const int
+    * @return  bool - true if sent
+    */
+   static bool    SendFd( const int socket, const int fd );
+
+   /**
+    * ReceiveFd - receive an fd sent with SendFd, blocks.
+    * @param   socket - const int
+    * @return  int - the new descriptor, -1 on error
+    */
+   static int     ReceiveFd( const int socket );
+
    /**
     * Close - returns true if successful, false otherwise.
     * @param   key - const char*
@@ -19,11 +19,50 @@
  */
 #ifndef _SIGNALVARS_HPP_
 #define _SIGNALVARS_HPP_  1
+#include <cstdint>
 
 enum RBSignal  {
    NONE = 0,
    RBEOF,
    QUIT,
-   TERM
+   TERM,
+   /** application defined signals start here, ( RBSignal )( RBUSER + n ) **/
+   RBUSER = 0x100
+};
+
+/**
+ * Per item metadata, kept in the signal slot next to each item so
+ * callers don't have to wrap their payload to carry it.  Each
+ * field is only compiled in when asked for:
+ *   RB_META_SEQUENCE   - producer's running count, set on push
+ *   RB_META_TIMESTAMP  - system_clock nanoseconds, set on push
+ *   RB_META_TAG        - user tag and flags, passed to push
+ * RB_META turns on all three.  Like RB_WAIT_STATS these change the
+ * layout of the queue (and of SHM segments), so every translation
+ * unit and both ends of an SHM queue need the same set.
+ */
+#ifdef RB_META
+#define RB_META_SEQUENCE   1
+#define RB_META_TIMESTAMP  1
+#define RB_META_TAG        1
+#endif
+
+#if defined RB_META_SEQUENCE || defined RB_META_TIMESTAMP || \
+    defined RB_META_TAG
+#define RB_META_ENABLED    1
+#endif
+
+struct SlotMeta
+{
+#ifdef RB_META_SEQUENCE
+   std::uint64_t  sequence;
+#endif
+#ifdef RB_META_TIMESTAMP
+   std::uint64_t  timestamp;
+#endif
+#ifdef RB_META_TAG
+   std::uint32_t  tag;
+   std::uint32_t  flags;
+#endif
 };
 #endif /* END _SIGNALVARS_HPP_ */
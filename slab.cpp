@@ -0,0 +1,285 @@
+/**
+ * slab.cpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 21:12:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thread>
+#include "slab.hpp"
+
+/** blocks and link arrays start on their own cache lines **/
+static inline size_t
+round_line( const size_t bytes )
+{
+   return( ( bytes + 63 ) & ~( (size_t) 63 ) );
+}
+
+Slab::Slab( const std::vector< SizeClass > &classes ) : heap_region( nullptr ),
+                                                        shm_region( nullptr ),
+                                                        base( nullptr ),
+                                                        header( nullptr )
+{
+   const std::vector< SizeClass > sorted( normalize( classes ) );
+   heap_region = new Buffer::Region< RingBufferType::Heap >( region_size( sorted ) );
+   base        = reinterpret_cast< char* >( heap_region->ptr );
+   format( sorted );
+}
+
+Slab::Slab( const std::vector< SizeClass > &classes,
+            const std::string key,
+            Direction dir ) : heap_region( nullptr ),
+                              shm_region( nullptr ),
+                              base( nullptr ),
+                              header( nullptr )
+{
+   const std::vector< SizeClass > sorted( normalize( classes ) );
+   shm_region = new Buffer::Region< RingBufferType::SharedMemory >(
+      region_size( sorted ), key, dir );
+   base       = reinterpret_cast< char* >( shm_region->ptr );
+   if( dir == Direction::Producer )
+   {
+      format( sorted );
+   }
+   else
+   {
+      attach( sorted );
+   }
+}
+
+Slab::~Slab()
+{
+   header = nullptr;
+   base   = nullptr;
+   delete( heap_region );
+   heap_region = nullptr;
+   delete( shm_region );
+   shm_region = nullptr;
+}
+
+Slab::Handle
+Slab::allocate( const size_t nbytes )
+{
+   for( std::uint32_t i( 0 ); i < header->nclasses; i++ )
+   {
+      ClassHeader &c( header->classes[ i ] );
+      if( c.bytes < nbytes )
+      {
+         continue;
+      }
+      std::uint32_t index( 0 );
+      if( pop( c, index ) )
+      {
+         return( c.blocks + ( (Handle) index * c.bytes ) );
+      }
+   }
+   return( 0 );
+}
+
+void
+Slab::release( const Handle handle )
+{
+   ClassHeader *c( owner( handle ) );
+   assert( c != nullptr );
+   push( *c, (std::uint32_t) ( ( handle - c->blocks ) / c->bytes ) );
+}
+
+size_t
+Slab::block_size( const Handle handle ) const
+{
+   const ClassHeader *c( owner( handle ) );
+   return( c != nullptr ? c->bytes : 0 );
+}
+
+size_t
+Slab::max_block() const
+{
+   return( header->classes[ header->nclasses - 1 ].bytes );
+}
+
+size_t
+Slab::available( const size_t nbytes ) const
+{
+   for( std::uint32_t i( 0 ); i < header->nclasses; i++ )
+   {
+      const ClassHeader &c( header->classes[ i ] );
+      if( c.bytes >= nbytes )
+      {
+         return( c.free.load( std::memory_order_relaxed ) );
+      }
+   }
+   return( 0 );
+}
+
+std::vector< Slab::SizeClass >
+Slab::normalize( const std::vector< SizeClass > &classes )
+{
+   if( classes.size() == 0 || classes.size() > max_classes )
+   {
+      std::cerr << "Slab needs between 1 and " << max_classes <<
+         " size classes, got (" << classes.size() << "), exiting!!\n";
+      exit( EXIT_FAILURE );
+   }
+   std::vector< SizeClass > sorted;
+   for( const SizeClass &c : classes )
+   {
+      if( c.bytes == 0 || c.count == 0 || c.count >= UINT32_MAX )
+      {
+         std::cerr << "Bad slab size class (" << c.bytes << " bytes x " <<
+            c.count << "), exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      sorted.push_back( SizeClass( round_line( c.bytes ), c.count ) );
+   }
+   std::sort( sorted.begin(), sorted.end(),
+              []( const SizeClass &a, const SizeClass &b )
+              {
+                 return( a.bytes < b.bytes );
+              } );
+   return( sorted );
+}
+
+size_t
+Slab::region_size( const std::vector< SizeClass > &classes )
+{
+   size_t total( round_line( sizeof( Header ) ) );
+   for( const SizeClass &c : classes )
+   {
+      total += round_line( sizeof( std::uint32_t ) * c.count );
+      total += c.bytes * c.count;
+   }
+   return( total );
+}
+
+void
+Slab::format( const std::vector< SizeClass > &classes )
+{
+   header = new ( base ) Header();
+   header->nclasses = (std::uint32_t) classes.size();
+   size_t offset( round_line( sizeof( Header ) ) );
+   for( size_t i( 0 ); i < classes.size(); i++ )
+   {
+      ClassHeader &c( header->classes[ i ] );
+      c.bytes  = classes[ i ].bytes;
+      c.count  = classes[ i ].count;
+      c.links  = offset;
+      offset  += round_line( sizeof( std::uint32_t ) * c.count );
+      c.blocks = offset;
+      offset  += c.bytes * c.count;
+      c.head.store( 0, std::memory_order_relaxed );
+      c.free.store( 0, std::memory_order_relaxed );
+      std::atomic< std::uint32_t > *next( links( c ) );
+      for( std::uint64_t j( 0 ); j < c.count; j++ )
+      {
+         next[ j ].store( 0, std::memory_order_relaxed );
+      }
+      /** push in reverse so the first allocations come from the front **/
+      for( std::uint64_t j( c.count ); j > 0; j-- )
+      {
+         push( c, (std::uint32_t) ( j - 1 ) );
+      }
+   }
+   header->magic.store( magic_value, std::memory_order_release );
+}
+
+void
+Slab::attach( const std::vector< SizeClass > &classes )
+{
+   header = reinterpret_cast< Header* >( base );
+   const auto deadline( std::chrono::steady_clock::now() +
+                        std::chrono::seconds( 10 ) );
+   while( header->magic.load( std::memory_order_acquire ) != magic_value )
+   {
+      if( std::chrono::steady_clock::now() > deadline )
+      {
+         std::cerr << "Timed out waiting for the slab creator, exiting!!\n";
+         exit( EXIT_FAILURE );
+      }
+      std::this_thread::yield();
+   }
+   bool same( header->nclasses == classes.size() );
+   for( size_t i( 0 ); same && i < classes.size(); i++ )
+   {
+      same = ( header->classes[ i ].bytes == classes[ i ].bytes &&
+               header->classes[ i ].count == classes[ i ].count );
+   }
+   if( ! same )
+   {
+      std::cerr << "Slab size classes don't match the creator's, exiting!!\n";
+      exit( EXIT_FAILURE );
+   }
+}
+
+void
+Slab::push( ClassHeader &c, const std::uint32_t index )
+{
+   std::atomic< std::uint32_t > *next( links( c ) );
+   std::uint64_t old_head( c.head.load( std::memory_order_relaxed ) );
+   std::uint64_t new_head( 0 );
+   do
+   {
+      next[ index ].store( (std::uint32_t) old_head, std::memory_order_relaxed );
+      new_head = ( ( ( old_head >> 32 ) + 1 ) << 32 ) | ( index + 1 );
+   }while( ! c.head.compare_exchange_weak( old_head,
+                                           new_head,
+                                           std::memory_order_release,
+                                           std::memory_order_relaxed ) );
+   c.free.fetch_add( 1, std::memory_order_relaxed );
+}
+
+bool
+Slab::pop( ClassHeader &c, std::uint32_t &index )
+{
+   std::atomic< std::uint32_t > *next( links( c ) );
+   std::uint64_t old_head( c.head.load( std::memory_order_acquire ) );
+   std::uint64_t new_head( 0 );
+   do
+   {
+      const std::uint32_t top( (std::uint32_t) old_head );
+      if( top == 0 )
+      {
+         return( false );
+      }
+      /** may be stale if top was taken meanwhile, the tag fails the CAS **/
+      new_head = ( ( ( old_head >> 32 ) + 1 ) << 32 ) |
+                 next[ top - 1 ].load( std::memory_order_relaxed );
+   }while( ! c.head.compare_exchange_weak( old_head,
+                                           new_head,
+                                           std::memory_order_acquire,
+                                           std::memory_order_acquire ) );
+   index = (std::uint32_t) old_head - 1;
+   c.free.fetch_sub( 1, std::memory_order_relaxed );
+   return( true );
+}
+
+Slab::ClassHeader*
+Slab::owner( const Handle handle ) const
+{
+   for( std::uint32_t i( 0 ); i < header->nclasses; i++ )
+   {
+      ClassHeader &c( header->classes[ i ] );
+      if( handle >= c.blocks && handle < c.blocks + ( c.bytes * c.count ) )
+      {
+         return( ( handle - c.blocks ) % c.bytes == 0 ? &c : nullptr );
+      }
+   }
+   return( nullptr );
+}
@@ -0,0 +1,179 @@
+/**
+ * slab.hpp - fixed size block pools in one region of memory, heap
+ * or SHM, handed out as offsets from the start of the region so
+ * the same handle means the same block in every process that maps
+ * it.  Large payloads go in a block, only the 8 byte handle goes
+ * through a queue (see slabchannel.tcc).
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 21:12:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SLAB_HPP_
+#define _SLAB_HPP_  1
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "ringbuffertypes.hpp"
+#include "region.tcc"
+
+/**
+ * Slab - a handful of size classes, each a fixed number of equal
+ * blocks with a lock free (Treiber stack) free list, so any thread
+ * in any process attached to the region may allocate or release.
+ * The list heads carry a tag bumped on every change so a head that
+ * was popped and pushed back in between can't be mistaken for the
+ * one a CAS loaded (ABA).  Links live in a separate array, blocks
+ * are all payload and aligned to a cache line.
+ *
+ * The creator (heap, or the SHM Producer) lays out and fills the
+ * free lists, an SHM Consumer waits for that and checks it asked
+ * for the same classes.
+ */
+class Slab
+{
+public:
+   /** offset of a block from the start of the region, 0 is none **/
+   typedef std::uint64_t Handle;
+
+   struct SizeClass
+   {
+      SizeClass( const size_t bytes, const size_t count ) : bytes( bytes ),
+                                                            count( count )
+      {}
+
+      /** usable bytes per block, rounded up to a cache line **/
+      size_t bytes;
+      /** number of blocks **/
+      size_t count;
+   };
+
+   static const size_t max_classes = 16;
+
+   /**
+    * Slab - heap backed, for threads within one process.
+    * @param classes - const std::vector< SizeClass >&, any order
+    */
+   Slab( const std::vector< SizeClass > &classes );
+
+   /**
+    * Slab - SHM backed, both ends pass the same classes and key.
+    * @param classes - const std::vector< SizeClass >&
+    * @param key     - const std::string, SHM key
+    * @param dir     - Direction, Producer creates, Consumer opens
+    */
+   Slab( const std::vector< SizeClass > &classes,
+         const std::string key,
+         Direction dir );
+
+   virtual ~Slab();
+
+   /**
+    * allocate - take a block from the smallest class that holds
+    * nbytes, moving up a class if that one is empty.  Never blocks.
+    * @param nbytes  - const size_t
+    * @return Handle - 0 if nothing big enough is free
+    */
+   Handle allocate( const size_t nbytes );
+
+   /**
+    * release - give a block back, from any thread or process.
+    * @param handle - const Handle, from allocate()
+    */
+   void release( const Handle handle );
+
+   /**
+    * get - this process's address of the block.
+    * @param handle - const Handle
+    * @return void*
+    */
+   inline void* get( const Handle handle ) const
+   {
+      return( base + handle );
+   }
+
+   /**
+    * block_size - usable bytes in the block behind handle.
+    * @param handle - const Handle
+    * @return size_t
+    */
+   size_t block_size( const Handle handle ) const;
+
+   /**
+    * max_block - usable bytes in the largest class, allocate()
+    * can never satisfy more.
+    * @return size_t
+    */
+   size_t max_block() const;
+
+   /**
+    * available - free blocks in the class holding nbytes, racy
+    * but fine for stats.
+    * @param nbytes - const size_t
+    * @return size_t
+    */
+   size_t available( const size_t nbytes ) const;
+
+protected:
+   /** per class bookkeeping, at the start of the region **/
+   struct ClassHeader
+   {
+      std::uint64_t                 bytes;
+      std::uint64_t                 count;
+      /** where block 0 is, and the count links **/
+      std::uint64_t                 blocks;
+      std::uint64_t                 links;
+      /** ( tag << 32 ) | ( index + 1 ), 0 is an empty list **/
+      alignas( 64 ) std::atomic< std::uint64_t >  head;
+      std::atomic< std::uint64_t >                free;
+   } __attribute__ ((aligned( 64 )));
+
+   struct Header
+   {
+      /** "SLAB", written last by the creator **/
+      std::atomic< std::uint32_t >  magic;
+      std::uint32_t                 nclasses;
+      ClassHeader                   classes[ max_classes ];
+   };
+
+   static const std::uint32_t magic_value = 0x534c4142;
+
+   /** sorted, rounded classes and the bytes the region needs **/
+   static std::vector< SizeClass > normalize( const std::vector< SizeClass > &classes );
+   static size_t region_size( const std::vector< SizeClass > &classes );
+
+   /** creator side, lay out the classes and fill the free lists **/
+   void format( const std::vector< SizeClass > &classes );
+   /** SHM Consumer side, wait for format() and check it matches **/
+   void attach( const std::vector< SizeClass > &classes );
+
+   inline std::atomic< std::uint32_t >* links( const ClassHeader &c ) const
+   {
+      return( reinterpret_cast< std::atomic< std::uint32_t >* >( base + c.links ) );
+   }
+
+   void push( ClassHeader &c, const std::uint32_t index );
+   bool pop( ClassHeader &c, std::uint32_t &index );
+   /** class holding handle, nullptr if it isn't a block **/
+   ClassHeader* owner( const Handle handle ) const;
+
+   Buffer::Region< RingBufferType::Heap >          *heap_region;
+   Buffer::Region< RingBufferType::SharedMemory >  *shm_region;
+   char                                            *base;
+   Header                                          *header;
+};
+#endif /* END _SLAB_HPP_ */
@@ -0,0 +1,239 @@
+/**
+ * slabchannel.tcc - zero copy transfer of large payloads, the
+ * payload is written once into a Slab block and only its 8 byte
+ * handle goes through a RingBuffer.  Finished blocks come back on
+ * a second (return) ring and the producer frees them as it goes,
+ * so the free lists are mostly touched by one core.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 21:12:44 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SLABCHANNEL_TCC_
+#define _SLABCHANNEL_TCC_  1
+#include <cassert>
+#include <string>
+#include <vector>
+#include "ringbuffer.tcc"
+#include "slab.hpp"
+
+/**
+ * SlabChannel - one producer, one consumer.  Heap channels are a
+ * single object shared by two threads, SHM channels are built by
+ * each process with the same key, classes and capacity.
+ *
+ * Producer:  ptr = allocate( n, handle ); fill ptr; send( handle );
+ * Consumer:  while( ( ptr = receive( handle ) ) != nullptr )
+ *            { use ptr; done( handle ); }
+ *
+ * Blocks the producer allocates but never sends are its to
+ * release(), otherwise allocate() can wait on returns forever.
+ * A consumer that stops before the channel is drained calls
+ * abandon() so the producer's allocate() and send() fail rather
+ * than wait, destroying an SHM consumer end does the same.
+ */
+template < RingBufferType type > class SlabChannel
+{
+public:
+   /**
+    * SlabChannel - heap backed, both threads use this object.
+    * @param classes  - const std::vector< Slab::SizeClass >&
+    * @param capacity - const size_t, handles in flight per ring
+    */
+   SlabChannel( const std::vector< Slab::SizeClass > &classes,
+                const size_t capacity ) :
+      slab( new Slab( classes ) ),
+      frames( new RingBuffer< Slab::Handle, type >( capacity ) ),
+      returns( new RingBuffer< Slab::Handle, type >( capacity ) )
+   {
+   }
+
+   /**
+    * SlabChannel - SHM backed, makes the segments key + "_slab",
+    * "_frames" and "_returns".  The rings handshake, so the other
+    * end must be constructing at the same time.
+    * @param classes  - const std::vector< Slab::SizeClass >&
+    * @param capacity - const size_t
+    * @param key      - const std::string
+    * @param dir      - Direction, this process's end
+    */
+   SlabChannel( const std::vector< Slab::SizeClass > &classes,
+                const size_t capacity,
+                const std::string key,
+                Direction dir ) :
+      slab( new Slab( classes, key + "_slab", dir ) ),
+      frames( new RingBuffer< Slab::Handle, type >( capacity,
+                                                    key + "_frames",
+                                                    dir ) ),
+      returns( new RingBuffer< Slab::Handle, type >( capacity,
+                                                     key + "_returns",
+                                                     dir == Direction::Producer ?
+                                                        Direction::Consumer :
+                                                        Direction::Producer ) )
+   {
+   }
+
+   virtual ~SlabChannel()
+   {
+      delete( frames );
+      frames = nullptr;
+      delete( returns );
+      returns = nullptr;
+      delete( slab );
+      slab = nullptr;
+   }
+
+   /**
+    * allocate - producer, a block of at least nbytes.  Frees
+    * whatever the consumer has returned first, then waits on the
+    * return ring if every block is out.
+    * @param nbytes - const size_t
+    * @param handle - Slab::Handle&, set on success
+    * @return void* - the block, nullptr if nbytes is bigger than
+    *                 any class or the consumer has gone
+    */
+   void* allocate( const size_t nbytes, Slab::Handle &handle )
+   {
+      if( nbytes > slab->max_block() )
+      {
+         return( nullptr );
+      }
+      reclaim();
+      while( ( handle = slab->allocate( nbytes ) ) == 0 )
+      {
+         if( frames->abandoned() )
+         {
+            return( nullptr );
+         }
+         Slab::Handle returned( 0 );
+         if( returns->pop( returned ) )
+         {
+            slab->release( returned );
+         }
+      }
+      return( slab->get( handle ) );
+   }
+
+   /**
+    * send - producer, pass a filled block to the consumer.
+    * @param handle - const Slab::Handle
+    * @param signal - const RBSignal, RBEOF closes the channel
+    * @return bool - false if the consumer has gone, the block is
+    *                released
+    */
+   bool send( const Slab::Handle handle,
+              const RBSignal signal = RBSignal::NONE )
+   {
+      Slab::Handle item( handle );
+      if( ! frames->push( item, signal ) )
+      {
+         slab->release( handle );
+         return( false );
+      }
+      return( true );
+   }
+
+   /**
+    * release - producer, give back a block that won't be sent.
+    * @param handle - const Slab::Handle
+    */
+   void release( const Slab::Handle handle )
+   {
+      slab->release( handle );
+   }
+
+   /** close - producer, end of stream, see RingBufferBase::close() **/
+   void close()
+   {
+      frames->close();
+   }
+
+   /**
+    * abandon - consumer, nothing more will be received.  A
+    * producer waiting in allocate() for a returned block, or in
+    * send() for room, gets nullptr / false instead.  Heap
+    * consumers must call it to stop early, the rings are shared
+    * so nothing happens on destruction.
+    */
+   void abandon()
+   {
+      /** abandoned first, allocate() checks it once returns runs dry **/
+      frames->abandon();
+      returns->close();
+   }
+
+   /**
+    * receive - consumer, the next block, blocks till there is one.
+    * @param handle - Slab::Handle&, pass to done() once finished
+    * @param signal - RBSignal*, default nullptr
+    * @return void* - the block, nullptr once the channel is drained
+    */
+   void* receive( Slab::Handle &handle, RBSignal *signal = nullptr )
+   {
+      if( ! frames->pop( handle, signal ) )
+      {
+         return( nullptr );
+      }
+      return( slab->get( handle ) );
+   }
+
+   /**
+    * done - consumer, finished with a block.  Goes back on the
+    * return ring, or straight onto the free list if that is full
+    * or the producer has gone, so it never blocks.
+    * @param handle - const Slab::Handle
+    */
+   void done( const Slab::Handle handle )
+   {
+      Slab::Handle item( handle );
+      if( returns->space_avail() == 0 || returns->abandoned() ||
+          ! returns->push( item ) )
+      {
+         slab->release( handle );
+      }
+   }
+
+   /**
+    * block_size - usable bytes behind handle.
+    * @param handle - const Slab::Handle
+    * @return size_t
+    */
+   size_t block_size( const Slab::Handle handle ) const
+   {
+      return( slab->block_size( handle ) );
+   }
+
+   /** the handle ring, e.g. to add to a QueueSet **/
+   RingBufferBase< Slab::Handle, type >& queue()
+   {
+      return( *frames );
+   }
+
+protected:
+   /** producer, free everything already returned **/
+   void reclaim()
+   {
+      Slab::Handle returned( 0 );
+      while( returns->size() > 0 && returns->pop( returned ) )
+      {
+         slab->release( returned );
+      }
+   }
+
+   Slab                                *slab;
+   RingBuffer< Slab::Handle, type >    *frames;
+   RingBuffer< Slab::Handle, type >    *returns;
+};
+#endif /* END _SLABCHANNEL_TCC_ */
@@ -0,0 +1,54 @@
+/**
+ * spinwait.hpp - what a spin loop does between checks, shared so
+ * the queue ends, QueueSet, the executors, the runtime workers and
+ * SeqLock readers all spin the same way and honor one NICE setting.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 23:52:06 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _SPINWAIT_HPP_
+#define _SPINWAIT_HPP_  1
+#include <thread>
+
+/**
+ * Note: there is a NICE define that can be uncommented
+ * below if you want sched_yield called when waiting for
+ * writes or blocking for space, otherwise blocking will
+ * actively spin while waiting.
+ */
+#define NICE 1
+
+/** spin_pause - spin loop hint, nothing off x86 **/
+static inline void spin_pause()
+{
+#if __x86_64
+   __asm__ volatile("\
+     pause"
+     :
+     :
+     : );
+#endif
+}
+
+/** spin_relax - one wait in a spin loop, yields too if NICE **/
+static inline void spin_relax()
+{
+#ifdef NICE
+   std::this_thread::yield();
+#endif
+   spin_pause();
+}
+#endif /* END _SPINWAIT_HPP_ */
@@ -22,6 +22,9 @@
 #include <cstring>
 #include <cstdint>
 #include <cinttypes>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
 #include <sys/utsname.h>
 
 #if __linux
@@ -926,3 +929,322 @@ SystemInfo::getUTSNameInfo( const Trait t )
       }
       return( std::string( 0 ) );
 }
+
+const Topology&
+SystemInfo::getTopology()
+{
+   /** function local static, initialized once even with threads **/
+   static const Topology topology;
+   return( topology );
+}
+
+#if __linux
+/**
+ * readSysFile - first line of a sysfs file, empty if the file
+ * doesn't exist (offline cpu, no NUMA support, etc.)
+ */
+static std::string
+readSysFile( const std::string &path )
+{
+   std::ifstream ifs( path );
+   std::string line;
+   if( ifs.is_open() )
+   {
+      std::getline( ifs, line );
+   }
+   return( line );
+}
+
+static int
+readSysInt( const std::string &path, const int def )
+{
+   const std::string value( readSysFile( path ) );
+   if( value.length() == 0 )
+   {
+      return( def );
+   }
+   return( std::atoi( value.c_str() ) );
+}
+
+/** sysfs cache sizes look like "32K" or "8192K" **/
+static std::uint64_t
+parseSize( const std::string &value )
+{
+   std::uint64_t size( std::strtoull( value.c_str(), nullptr, 10 ) );
+   if( value.find( 'K' ) != std::string::npos )
+   {
+      size <<= 10;
+   }
+   else if( value.find( 'M' ) != std::string::npos )
+   {
+      size <<= 20;
+   }
+   return( size );
+}
+#endif
+
+Topology::Topology()
+{
+#if __linux
+   const std::string cpu_root( "/sys/devices/system/cpu/" );
+   std::vector< int > online( 
+      Topology::parseCPUList( readSysFile( cpu_root + "online" ) ) );
+   if( online.size() == 0 )
+   {
+      for( int i( 0 ); i < get_nprocs(); i++ )
+      {
+         online.push_back( i );
+      }
+   }
+   for( const int cpu : online )
+   {
+      const std::string base( cpu_root + "cpu" + std::to_string( cpu ) + "/" );
+      CPUInfo info;
+      info.cpu     = cpu;
+      info.package = readSysInt( base + "topology/physical_package_id", 0 );
+      info.core    = readSysInt( base + "topology/core_id", cpu );
+      info.node    = 0;
+      info.smt_siblings = Topology::parseCPUList( 
+         readSysFile( base + "topology/thread_siblings_list" ) );
+      if( info.smt_siblings.size() == 0 )
+      {
+         info.smt_siblings.push_back( cpu );
+      }
+      for( int index( 0 ); ; index++ )
+      {
+         const std::string cache( base + "cache/index" + 
+                                  std::to_string( index ) + "/" );
+         const std::string level( readSysFile( cache + "level" ) );
+         if( level.length() == 0 )
+         {
+            break;
+         }
+         CacheGroup group;
+         group.level     = std::atoi( level.c_str() );
+         group.type      = readSysFile( cache + "type" );
+         group.size      = parseSize( readSysFile( cache + "size" ) );
+         group.line_size = readSysInt( cache + "coherency_line_size", 64 );
+         group.cpus      = Topology::parseCPUList( 
+            readSysFile( cache + "shared_cpu_list" ) );
+         if( group.cpus.size() == 0 )
+         {
+            group.cpus.push_back( cpu );
+         }
+         /** every cpu in the group reports it, keep one copy **/
+         size_t found( caches.size() );
+         for( size_t i( 0 ); i < caches.size(); i++ )
+         {
+            if( caches[ i ].level == group.level &&
+                caches[ i ].type  == group.type  &&
+                caches[ i ].cpus  == group.cpus )
+            {
+               found = i;
+               break;
+            }
+         }
+         if( found == caches.size() )
+         {
+            caches.push_back( group );
+         }
+         info.caches.push_back( found );
+      }
+      cpus.push_back( info );
+   }
+   /** node ids use the same list format, may be sparse **/
+   const std::string node_root( "/sys/devices/system/node/" );
+   const std::vector< int > node_ids(
+      Topology::parseCPUList( readSysFile( node_root + "online" ) ) );
+   for( const int node : node_ids )
+   {
+      if( (size_t) node >= nodes.size() )
+      {
+         nodes.resize( node + 1 );
+      }
+      nodes[ node ] = Topology::parseCPUList( 
+         readSysFile( node_root + "node" + std::to_string( node ) + "/cpulist" ) );
+      for( const int cpu : nodes[ node ] )
+      {
+         for( CPUInfo &info : cpus )
+         {
+            if( info.cpu == cpu )
+            {
+               info.node = node;
+            }
+         }
+      }
+   }
+#else
+   const int n( std::atoi( 
+      SystemInfo::getSystemProperty( NumberOfProcessors ).c_str() ) );
+   for( int cpu( 0 ); cpu < n; cpu++ )
+   {
+      CPUInfo info;
+      info.cpu     = cpu;
+      info.package = 0;
+      info.core    = cpu;
+      info.node    = 0;
+      info.smt_siblings.push_back( cpu );
+      cpus.push_back( info );
+   }
+#endif
+   if( nodes.size() == 0 )
+   {
+      nodes.push_back( getCPUs() );
+   }
+}
+
+size_t
+Topology::numCPUs() const
+{
+   return( cpus.size() );
+}
+
+size_t
+Topology::numNodes() const
+{
+   return( nodes.size() );
+}
+
+std::vector< int >
+Topology::getCPUs() const
+{
+   std::vector< int > out;
+   for( const CPUInfo &info : cpus )
+   {
+      out.push_back( info.cpu );
+   }
+   return( out );
+}
+
+const CPUInfo*
+Topology::getCPU( const int cpu ) const
+{
+   for( const CPUInfo &info : cpus )
+   {
+      if( info.cpu == cpu )
+      {
+         return( &info );
+      }
+   }
+   return( nullptr );
+}
+
+int
+Topology::getNode( const int cpu ) const
+{
+   const CPUInfo *info( getCPU( cpu ) );
+   return( info != nullptr ? info->node : 0 );
+}
+
+std::vector< int >
+Topology::getNodeCPUs( const int node ) const
+{
+   if( node < 0 || (size_t) node >= nodes.size() )
+   {
+      return( std::vector< int >() );
+   }
+   return( nodes[ node ] );
+}
+
+bool
+Topology::areSMTSiblings( const int a, const int b ) const
+{
+   const CPUInfo *info( getCPU( a ) );
+   if( info == nullptr || a == b )
+   {
+      return( false );
+   }
+   return( std::find( info->smt_siblings.begin(),
+                      info->smt_siblings.end(),
+                      b ) != info->smt_siblings.end() );
+}
+
+bool
+Topology::samePackage( const int a, const int b ) const
+{
+   const CPUInfo *info_a( getCPU( a ) );
+   const CPUInfo *info_b( getCPU( b ) );
+   if( info_a == nullptr || info_b == nullptr )
+   {
+      return( false );
+   }
+   return( info_a->package == info_b->package );
+}
+
+int
+Topology::sharedCacheLevel( const int a, const int b ) const
+{
+   const CPUInfo *info( getCPU( a ) );
+   if( info == nullptr )
+   {
+      return( 0 );
+   }
+   int level( 0 );
+   for( const size_t index : info->caches )
+   {
+      const CacheGroup &group( caches[ index ] );
+      if( group.type == "Instruction" )
+      {
+         continue;
+      }
+      if( std::find( group.cpus.begin(), 
+                     group.cpus.end(), 
+                     b ) != group.cpus.end() )
+      {
+         if( level == 0 || group.level < level )
+         {
+            level = group.level;
+         }
+      }
+   }
+   return( level );
+}
+
+std::vector< int >
+Topology::getCacheSharingCPUs( const int cpu,
+                               const int level ) const
+{
+   const CPUInfo *info( getCPU( cpu ) );
+   if( info != nullptr )
+   {
+      for( const size_t index : info->caches )
+      {
+         const CacheGroup &group( caches[ index ] );
+         if( group.level == level && group.type != "Instruction" )
+         {
+            return( group.cpus );
+         }
+      }
+   }
+   return( std::vector< int >() );
+}
+
+std::vector< int >
+Topology::parseCPUList( const std::string &list )
+{
+   std::vector< int > out;
+   std::stringstream ss( list );
+   std::string range;
+   while( std::getline( ss, range, ',' ) )
+   {
+      if( range.length() == 0 )
+      {
+         continue;
+      }
+      const size_t dash( range.find( '-' ) );
+      if( dash == std::string::npos )
+      {
+         out.push_back( std::atoi( range.c_str() ) );
+      }
+      else
+      {
+         const int begin( std::atoi( range.substr( 0, dash ).c_str() ) );
+         const int end( std::atoi( range.substr( dash + 1 ).c_str() ) );
+         for( int i( begin ); i <= end; i++ )
+         {
+            out.push_back( i );
+         }
+      }
+   }
+   return( out );
+}
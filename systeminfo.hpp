@@ -19,7 +19,9 @@
  */
 #ifndef _SYSTEMINFO_HPP_
 #define _SYSTEMINFO_HPP_  1
+#include <cstdint>
 #include <string>
+#include <vector>
 
 /**
  * enum Trait - defines all the system parameters
@@ -70,6 +72,83 @@ enum Trait {
    N
 };
 
+/**
+ * CacheGroup - one cache instance and the logical cpus that
+ * share it, e.g. one L3 per socket or one L2 per core pair.
+ */
+struct CacheGroup
+{
+   int                  level;
+   /** "Data", "Instruction" or "Unified" **/
+   std::string          type;
+   std::uint64_t        size;
+   std::uint64_t        line_size;
+   std::vector< int >   cpus;
+};
+
+/**
+ * CPUInfo - where one logical cpu sits in the machine.
+ */
+struct CPUInfo
+{
+   int                  cpu;
+   int                  package;
+   int                  core;
+   int                  node;
+   /** logical cpus on the same physical core, including this one **/
+   std::vector< int >   smt_siblings;
+   /** indices into Topology::caches, lowest level first **/
+   std::vector< size_t > caches;
+};
+
+/**
+ * Topology - snapshot of the online cpus, the caches they share
+ * and the NUMA nodes they belong to.  Built once from sysfs on
+ * Linux (a single flat package/node elsewhere) and cached, get
+ * it with SystemInfo::getTopology().
+ */
+class Topology
+{
+public:
+   Topology();
+
+   /** number of online logical cpus **/
+   size_t               numCPUs() const;
+   /** number of NUMA nodes, at least one **/
+   size_t               numNodes() const;
+   /** online logical cpu ids **/
+   std::vector< int >   getCPUs() const;
+   /** info for logical cpu, nullptr if cpu isn't online **/
+   const CPUInfo*       getCPU( const int cpu ) const;
+   /** NUMA node of cpu, 0 if unknown **/
+   int                  getNode( const int cpu ) const;
+   /** logical cpus on node **/
+   std::vector< int >   getNodeCPUs( const int node ) const;
+   /** true if a and b are hardware threads of one core **/
+   bool                 areSMTSiblings( const int a, const int b ) const;
+   /** true if a and b are in the same package (socket) **/
+   bool                 samePackage( const int a, const int b ) const;
+   /**
+    * sharedCacheLevel - lowest data/unified cache level that a
+    * and b share, 0 if they share none.
+    */
+   int                  sharedCacheLevel( const int a, const int b ) const;
+   /** logical cpus sharing cpu's data/unified cache at level **/
+   std::vector< int >   getCacheSharingCPUs( const int cpu,
+                                             const int level ) const;
+   /**
+    * parseCPUList - parse a kernel cpu list ("0-3,8,10-11").
+    * @param list - const std::string&
+    * @return std::vector< int >
+    */
+   static std::vector< int > parseCPUList( const std::string &list );
+
+   std::vector< CPUInfo >     cpus;
+   std::vector< CacheGroup >  caches;
+   /** logical cpus per NUMA node, indexed by node id **/
+   std::vector< std::vector< int > > nodes;
+};
+
 class SystemInfo
 {
 public:
@@ -98,6 +177,13 @@ public:
     * @return  size_t - number of traits.
     */
    static size_t        getNumTraits();
+
+   /**
+    * getTopology - cpu, cache sharing and NUMA layout.  Built on
+    * first call and cached, safe to call from any thread.
+    * @return const Topology&
+    */
+   static const Topology& getTopology();
 protected:
    /**
     * getUTSNameInfo - helper method to get UTSName info for both
@@ -0,0 +1,100 @@
+/**
+ * waitstats.hpp -
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 19:02:51 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _WAITSTATS_HPP_
+#define _WAITSTATS_HPP_  1
+#include <atomic>
+#include <cstdint>
+
+/**
+ * WaitCounts - plain copy of one endpoint's WaitStats, what
+ * RingBufferBase::wait_stats() hands back.  All zero unless the
+ * tree is built with -DRB_WAIT_STATS.
+ */
+struct WaitCounts
+{
+   WaitCounts() : waits( 0 ),
+                  spins( 0 ),
+                  yields( 0 ),
+                  sleeps( 0 ),
+                  blocked_ns( 0 )
+   {}
+
+   /** calls that found the queue full (producer) or empty (consumer) **/
+   std::uint64_t waits;
+   /** pause instructions issued while waiting **/
+   std::uint64_t spins;
+   std::uint64_t yields;
+   /** futex sleeps taken through a QueueSet **/
+   std::uint64_t sleeps;
+   /** total time between finding the queue not ready and it being ready **/
+   std::uint64_t blocked_ns;
+};
+
+/**
+ * WaitStats - live counters for one end of a queue.  Only that
+ * end's thread writes them so increments are a relaxed load and
+ * store, any other thread may read() at any time.
+ */
+struct WaitStats
+{
+   WaitStats() : waits( 0 ),
+                 spins( 0 ),
+                 yields( 0 ),
+                 sleeps( 0 ),
+                 blocked_ns( 0 )
+   {}
+
+   static inline void add( std::atomic< std::uint64_t > &counter,
+                           const std::uint64_t n = 1 )
+   {
+      counter.store( counter.load( std::memory_order_relaxed ) + n,
+                     std::memory_order_relaxed );
+   }
+
+   WaitCounts read() const
+   {
+      WaitCounts counts;
+      counts.waits      = waits.load( std::memory_order_relaxed );
+      counts.spins      = spins.load( std::memory_order_relaxed );
+      counts.yields     = yields.load( std::memory_order_relaxed );
+      counts.sleeps     = sleeps.load( std::memory_order_relaxed );
+      counts.blocked_ns = blocked_ns.load( std::memory_order_relaxed );
+      return( counts );
+   }
+
+   std::atomic< std::uint64_t > waits;
+   std::atomic< std::uint64_t > spins;
+   std::atomic< std::uint64_t > yields;
+   std::atomic< std::uint64_t > sleeps;
+   std::atomic< std::uint64_t > blocked_ns;
+};
+
+/**
+ * RB_WAIT_COUNT - bump a WaitStats field, compiles to nothing
+ * unless RB_WAIT_STATS is defined (for every translation unit,
+ * it changes the size of RingBufferBase).
+ */
+#ifdef RB_WAIT_STATS
+#define RB_WAIT_COUNT( STATS, FIELD, N ) WaitStats::add( (STATS).FIELD, N )
+#else
+#define RB_WAIT_COUNT( STATS, FIELD, N )
+#endif
+
+#endif /* END _WAITSTATS_HPP_ */
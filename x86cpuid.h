@@ -0,0 +1,186 @@
+/**
+ * x86cpuid.h - cpuid helpers, pulled out of cpy_assembly.c so
+ * the clocks can use them too.  Everything is static inline so
+ * this can be included from C or C++ in as many units as needed.
+ * @author: Jonathan Beard
+ * @version: Sun Oct 18 15:42:51 2026
+ *
+ * Copyright 2014 Jonathan Beard
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at:
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#ifndef _X86CPUID_H_
+#define _X86CPUID_H_  1
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+typedef struct {
+     uint32_t
+         CF      :  1,
+                 :  1,
+         PF      :  1,
+                 :  1,
+         AF      :  1,
+                 :  1,
+         ZF      :  1,
+         SF      :  1,
+         TF      :  1,
+         IF      :  1,
+         DF      :  1,
+         OF      :  1,
+         IOPL    :  2,
+         NT      :  1,
+                 :  1,
+         RF      :  1,
+         VM      :  1,
+         AC      :  1,
+         VIF     :  1,
+         VIP     :  1,
+         ID      :  1,
+                 : 10;
+} EFlags;
+
+
+typedef struct {
+   uint32_t eax, ebx, ecx, edx;
+} Reg;
+
+enum feature_levels {
+	FL_NONE,
+	FL_MMX,
+	FL_SSE2,
+	FL_AVX
+};
+
+
+#define    CPUID_BASIC     0x0
+#define    CPUID_LEVEL1    0x1
+#define    CPUID_EXT_BASIC 0x80000000
+#define    CPUID_EXT_POWER 0x80000007
+
+static inline void zero_registers (Reg *in)
+{
+	in->eax = 0x0;
+	in->ebx = 0x0;
+	in->ecx = 0x0;
+	in->edx = 0x0;
+}
+
+
+/**
+ * get_cpuid - sets eax, ebx, ecx, edx values in struct Reg based on input_eax input
+ */
+static inline void get_cpuid (Reg *input_registers, Reg *output_registers)
+{
+#if( __i386__ == 1 || __x86_64 == 1 )
+   __asm__ volatile ("\
+      movl  %[input_eax], %%eax     \n\
+      movl  %[input_ecx], %%ecx     \n\
+      cpuid                         \n\
+      movl  %%eax,        %[eax]    \n\
+      movl  %%ebx,        %[ebx]    \n\
+      movl  %%ecx,        %[ecx]    \n\
+      movl  %%edx,        %[edx]"
+      :
+      [eax] "=r"  (output_registers->eax),
+      [ebx] "=r"  (output_registers->ebx),
+      [ecx] "=r"  (output_registers->ecx),
+      [edx] "=r"  (output_registers->edx)
+      :
+      [input_eax] "m" (input_registers->eax),
+      [input_ecx] "m" (input_registers->ecx)
+      :
+      "eax","ebx","ecx","edx"
+      );
+#else
+   zero_registers( output_registers );
+#endif
+}
+
+static inline int get_level0_data (unsigned int *max_level)
+{
+	Reg in, out;
+
+	zero_registers(&in);
+	in.eax = CPUID_BASIC;
+	get_cpuid(&in, &out);
+	
+	if (max_level)
+		*max_level = out.eax;
+		
+	return 0;
+}
+
+
+static inline int get_level1_data (unsigned int max_level, unsigned int *eax, 
+	unsigned int *ecx, unsigned int *edx)
+{
+	Reg in, out;
+
+	zero_registers(&in);
+	in.eax = CPUID_LEVEL1;
+	get_cpuid(&in, &out);
+	
+	if (eax) *eax = out.eax;
+	if (ecx) *ecx = out.ecx;
+	if (edx) *edx = out.edx;
+	
+	return 0;
+}
+
+static inline enum feature_levels get_highest_feature (unsigned int max_level)
+{
+	unsigned int ecx, edx;
+
+	if (max_level < 1) {
+		fprintf(stderr, "Error calling cpuid, cpuid not supported\n");
+		exit(-1);
+	}
+	
+	get_level1_data(max_level, NULL, &ecx, &edx);
+
+	if (ecx & (1 << 28))
+		return FL_AVX;
+
+	if (edx & (1 << 26))
+		return FL_SSE2;
+		
+	if (edx & (1 << 23))
+		return FL_MMX;
+			
+	return FL_NONE;
+}
+
+/**
+ * get_invariant_tsc - non-zero if the time stamp counter runs at
+ * a constant rate through P-, C- and T-state changes (CPUID
+ * 0x80000007 EDX bit 8), i.e. it can be used as a wall clock.
+ */
+static inline int get_invariant_tsc (void)
+{
+	Reg in, out;
+
+	zero_registers(&in);
+	in.eax = CPUID_EXT_BASIC;
+	get_cpuid(&in, &out);
+	if (out.eax < CPUID_EXT_POWER)
+		return 0;
+
+	zero_registers(&in);
+	in.eax = CPUID_EXT_POWER;
+	get_cpuid(&in, &out);
+	return ((out.edx & (1 << 8)) != 0);
+}
+
+#endif /* END _X86CPUID_H_ */